@@ -29,6 +29,34 @@
  * |  4  |      |  2   |              |  4  |      |  2   |                                                                                                                 *
  * ---------------------              ---------------------                                                                                                                 *
  * The next position is unoccupied, so we place the next number there and continue the process - (figure [6]).                                                              *
+ *                                                                                                                                                                          *
+ * Rather than walking the square, the odd fill writes it row by row. Number k (counting from 0) is step p = k%n of block q = k/n, and it lands in row 2q-p, column q-p+n/2 *
+ * (mod n). So moving one column right in a row means the next block (q+1) and two steps further along it (p+2), and each element costs two increments.                     *
+ *--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*
+ *                                                           Creating a Doubly-Even nxn Magic Square (n divisible by 4)                                                     *
+ *--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*
+ * Write the numbers 1 to n^2 in order, row by row, then split the square into 4x4 blocks. Every number on one of the two diagonals of its 4x4 block is replaced by its     *
+ * complement (n^2+1 - number). Each row and column of a block holds two complemented numbers, which is enough to even out the row, column and diagonal sums.               *
+ *         [4x4]                        [4x4 complemented]                                                                                                                  *
+ * _____________________            _____________________                                                                                                                   *
+ * |  1 |  2 |  3 |  4 |            | 16 |  2 |  3 | 13 |                                                                                                                   *
+ * |----|----|----|----|            |----|----|----|----|                                                                                                                   *
+ * |  5 |  6 |  7 |  8 |    ==>     |  5 | 11 | 10 |  8 |                                                                                                                   *
+ * |----|----|----|----|            |----|----|----|----|                                                                                                                   *
+ * |  9 | 10 | 11 | 12 |            |  9 |  7 |  6 | 12 |                                                                                                                   *
+ * |----|----|----|----|            |----|----|----|----|                                                                                                                   *
+ * | 13 | 14 | 15 | 16 |            |  4 | 14 | 15 |  1 |                                                                                                                   *
+ * ---------------------            ---------------------                                                                                                                   *
+ * Whether a number is complemented depends only on its position, so the fill is a single row by row pass.                                                                  *
+ *--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*
+ *                                                     Creating a Singly-Even nxn Magic Square (n = 4m+2, LUX Method)                                                       *
+ *--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*
+ * Build the odd (2m+1)x(2m+1) square as above, then replace each of its numbers k with a 2x2 block holding 4(k-1)+1 to 4(k-1)+4, in one of three patterns:                 *
+ *       L          U          X         The first m+1 rows of blocks use L, the next row uses U, and the remaining m-1 rows use X.                                         *
+ *   _______    _______    _______      Then the L in the middle of the square swaps places with the U below it.                                                            *
+ *    | 4 1 |    | 1 4 |    | 1 4 |      The patterns keep the odd square's row, column and diagonal sums balanced, so the result is magic.                                 *
+ *    | 2 3 |    | 2 3 |    | 3 2 |      Each row of blocks fills two rows of the square at once, writing both in order.                                                    *
+ *    -------    -------    -------                                                                                                                                         *
  *--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*
  *                                                                                                                                                                          *
  * =========================================================================================================================================================================*/
@@ -39,17 +67,44 @@
 #include "MagicSquares.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 /*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
 /* Constants: */
 
-static const int MAX_MAGIC_NUMBER = 30000;      // Maximum value allowed in given magic square (somewhat arbitrary, higher values will work)
+static const int MAX_MAGIC_NUMBER = INT_MAX;    // Maximum value allowed in given magic square (anything larger overflows an int)
 static const int MIN_MAGIC_NUMBER = 1;          // Minimum value allowed in given magic square
 static const int MAX_RAND = 10;                 // Upper limit for range of randomly generated values (for increasing/decreasing magic numbers)
 static const int MIN_RAND = 1;                  // Lower limit for range of randomly generated values (for increasing/decreasing magic numbers)
-static const int MAX_SIZE = 11;                 // Maximum size allowed for creating magic square (somewhat arbitrary, works with larger sizes)
+static const int MAX_SIZE = 46340;              // Maximum size allowed for creating magic square (largest n where n^2, the largest magic number, fits an int)
 static const int MIN_SIZE = 1;                  // Minimum size allowed for creating magic square
+static const int PARALLEL_MIN = 1 << 20;        // Fewest numbers worth splitting a pass over the magic square across threads (4MB)
+static const int VIEW_SWAP = 1;                 // View bit: the row & column indices are swapped (see ms_state)
+static const int VIEW_FLIP_I = 2;               // View bit: the first index is counted from the end (i -> n-i-1)
+static const int VIEW_FLIP_J = 4;               // View bit: the second index is counted from the end (j -> n-j-1)
+
+/*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
+/* Types: */
+
+/* State of a magic square that hasn't been applied to its numbers yet, kept in the MS_ALIGN bytes before its row pointers. Every transform is one of the 8                 */
+/* symmetries of a square (the dihedral group D4) & every increase/decrease is an offset, so a chain of them collapses to one view & one offset:                            */
+/* number [i][j] of the square is stored at [x][y], where (x,y) = (j,i) if VIEW_SWAP is set (else (i,j)), then x -> n-x-1 if VIEW_FLIP_I & y -> n-y-1 if VIEW_FLIP_J,       */
+/* plus offset. materialize_ms applies them to the stored numbers.                                                                                                          */
+typedef struct {
+    int view;                   // pending symmetry (VIEW_* bits)
+    int offset;                 // pending amount to add to every stored number
+    int increase;               // total amount the numbers have been increased since the square was filled (pending offset included)
+} ms_state;
+
+_Static_assert(sizeof(ms_state) <= MS_ALIGN, "ms_state must fit in the MS_ALIGN bytes before the row pointers");
 
 /*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
 /* Utility Functions: */
@@ -57,17 +112,283 @@ static const int MIN_SIZE = 1;                  // Minimum size allowed for crea
 /* Function for clearing stdin */
 static inline void clear_stdin(void) { while(getchar()!='\n'); }
 
-/* Functions for determing the current and original center numbers of nxn magic square */
-static inline int get_original_center( int n)          { return n*(n/2) + ((n/2)+1); }
-static inline  int get_current_center(int **ms, int n)  { return ms[n/2][n/2]; }
+/* Function for determining the row stride (in ints) of an nxn magic square: n rounded up to a whole number of MS_ALIGN byte cache lines. A stride that's a multiple of     */
+/* 4KB gets one more line: otherwise every element of a column maps to the same few cache sets, and walking down a column (transposing) evicts itself                       */
+static inline int get_stride(int n) {
+    const int line = MS_ALIGN/sizeof(int);
+    int stride = (n + line - 1) / line * line;
+    return (stride % (4096/sizeof(int))) ? stride : stride + line;
+}
+
+/* Function for finding a magic square's state (see ms_state) */
+static inline ms_state *get_state(int **ms) { return (ms_state *)((char *)ms - MS_ALIGN); }
+
+/* Function for determining how much the magic numbers have been increased (0 for the original numbers 1 to n^2) */
+static inline int get_increase(int **ms, int n)        { (void)n; return get_state(ms)->increase; }
 
 /* Functions for determing the current and original max numbers of nxn magic square */
 static inline int get_original_largest(int n)          { return n*n; }
-static inline int get_current_largest(int **ms, int n) { return (get_original_largest(n) + (get_current_center(ms,n) - get_original_center(n))); }
+static inline int get_current_largest(int **ms, int n) { return get_original_largest(n) + get_increase(ms,n); }
 
 /* Functions for determing the maximum amounts magic numbers can be increased/decreased */
 static inline int get_max_increase(int **ms, int n)    { return MAX_MAGIC_NUMBER - get_current_largest(ms,n); }
-static inline int get_max_decrease(int **ms, int n)    { return get_current_center(ms,n) - get_original_center(n); }
+static inline int get_max_decrease(int **ms, int n)    { return get_increase(ms,n); }
+
+/* Function for the storage of a magic square as it is, without applying its state first */
+static inline ms_matrix get_storage(int **ms, int n)   { return (ms_matrix){ ms[0], n, get_stride(n) }; }
+
+/* Function for composing view (where the current square's numbers are stored) with op (where each number of the transformed square comes from in the current one):         */
+/* the result maps the transformed square straight to storage. A view with VIEW_SWAP set swaps which of op's flips lands on which index                                     */
+static inline int compose_view(int view, int op) {
+    int flips = (view & VIEW_SWAP) ? ((op & VIEW_FLIP_I) ? VIEW_FLIP_J : 0) | ((op & VIEW_FLIP_J) ? VIEW_FLIP_I : 0) : op & ~VIEW_SWAP;
+    return ((view ^ op) & VIEW_SWAP) | ((view & ~VIEW_SWAP) ^ flips);
+}
+
+/* Functions for transforming & increasing/decreasing a magic square: both only update its state, in O(1) */
+static inline void view_ms(int **ms, int op)           { get_state(ms)->view = compose_view(get_state(ms)->view, op); }
+static inline void add_ms(int **ms, int amount)        { get_state(ms)->offset += amount, get_state(ms)->increase += amount; }
+
+/*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
+/* Filling Functions: (see top of file) */
+
+/* Function for filling an odd nxn magic square (Siamese method). q/p: block and step of the number in the current element (the number is q*n + p + 1)                      */
+static void fill_odd_ms(int **ms, int n) {
+    for (int r = 0; r < n; r++) {
+        int q = (r + n - n/2) % n, p = (2*q + n - r) % n;                  // block & step of the number in column 0 of row r
+        for (int c = 0; c < n; c++) {
+            ms[r][c] = q*n + p + 1;
+            if (++q == n) q = 0;                                            // one column right: next block (wrapping around)...
+            if ((p += 2) >= n) p -= n;                                      // ...two steps further (wrapping around)
+        }
+    }
+}
+
+/* Function for filling a doubly-even nxn magic square. Numbers on the diagonals of each 4x4 block are complemented */
+static void fill_doubly_even_ms(int **ms, int n) {
+    for (int r = 0, k = 1; r < n; r++) {
+        for (int c = 0; c < n; c++, k++) {
+            ms[r][c] = (r%4 == c%4 || r%4 + c%4 == 3) ? n*n + 1 - k : k;
+        }
+    }
+}
+
+/* Function for filling a singly-even nxn magic square (LUX method). Each number of the odd square (filled as in fill_odd_ms) becomes a 2x2 block */
+static void fill_singly_even_ms(int **ms, int n) {
+    static const int lux[3][2][2] = { {{4,1},{2,3}}, {{1,4},{2,3}}, {{1,4},{3,2}} };     // L, U & X patterns
+    int k = n/2, m = k/2;
+    for (int r = 0; r < k; r++) {
+        int q = (r + k - k/2) % k, p = (2*q + k - r) % k;
+        int *top = ms[2*r], *bottom = ms[2*r+1];
+        for (int c = 0; c < k; c++) {
+            int t = (r <= m) ? 0 : (r == m+1) ? 1 : 2;                      // rows 0 to m: L, row m+1: U, below: X
+            if (c == m && (r == m || r == m+1)) t = 1 - t;                  // the middle L & the U below it swap places
+            int base = 4*(q*k + p);
+            top[2*c] = base + lux[t][0][0], top[2*c+1] = base + lux[t][0][1];
+            bottom[2*c] = base + lux[t][1][0], bottom[2*c+1] = base + lux[t][1][1];
+            if (++q == k) q = 0;
+            if ((p += 2) >= k) p -= k;
+        }
+    }
+}
+
+/* Function for filling an nxn magic square of any order (except 2) */
+static void fill_ms(int **ms, int n) {
+    if (!even(n)) fill_odd_ms(ms,n);
+    else if (even(n/2)) fill_doubly_even_ms(ms,n);
+    else fill_singly_even_ms(ms,n);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
+/* Matrix Functions: (work on the contiguous storage, walking memory in order wherever the transform allows it) */
+
+/* Function for swapping a[j] with end[-1-j] for j in [0, count): exchanges a with the reverse of the count ints before end. Reverses a row in place when a & end are its   */
+/* two ends (count = half the row). Runs 4 ints at a time with SSE2, reversing each group of 4 with a shuffle                                                               */
+static inline void swap_reversed(int *a, int *end, int count) {
+    int j = 0;
+#if defined(__SSE2__)
+    for (; j+4 <= count; j += 4) {
+        __m128i x = _mm_loadu_si128((__m128i *)(a+j)), y = _mm_loadu_si128((__m128i *)(end-j-4));
+        _mm_storeu_si128((__m128i *)(a+j), _mm_shuffle_epi32(y, _MM_SHUFFLE(0,1,2,3)));
+        _mm_storeu_si128((__m128i *)(end-j-4), _mm_shuffle_epi32(x, _MM_SHUFFLE(0,1,2,3)));
+    }
+#endif
+    for (; j < count; j++) {
+        swap(a[j],end[-1-j]);
+    }
+}
+
+/* Function for transposing an MS_TILE x MS_TILE tile from src into dst (the two must not overlap). With SSE2, each 4x4 quarter is loaded as 4 registers, transposed        */
+/* with unpacks & stored to the mirrored quarter. Tiles start on 32 byte boundaries (rows are MS_ALIGN aligned & tiles MS_TILE ints apart), so the loads are aligned        */
+static inline void transpose_tile(const int *src, int src_stride, int *dst, int dst_stride) {
+#if defined(__SSE2__)
+    for (int h = 0; h < MS_TILE; h += 4) {
+        for (int w = 0; w < MS_TILE; w += 4) {
+            const int *s = src + (size_t)h*src_stride + w;
+            int *d = dst + (size_t)w*dst_stride + h;
+            __m128i r0 = _mm_load_si128((const __m128i *)s), r1 = _mm_load_si128((const __m128i *)(s + src_stride));
+            __m128i r2 = _mm_load_si128((const __m128i *)(s + 2*src_stride)), r3 = _mm_load_si128((const __m128i *)(s + 3*src_stride));
+            __m128i t0 = _mm_unpacklo_epi32(r0,r1), t1 = _mm_unpacklo_epi32(r2,r3);         // a0 b0 a1 b1 | c0 d0 c1 d1
+            __m128i t2 = _mm_unpackhi_epi32(r0,r1), t3 = _mm_unpackhi_epi32(r2,r3);         // a2 b2 a3 b3 | c2 d2 c3 d3
+            _mm_store_si128((__m128i *)d, _mm_unpacklo_epi64(t0,t1));                      // a0 b0 c0 d0
+            _mm_store_si128((__m128i *)(d + dst_stride), _mm_unpackhi_epi64(t0,t1));       // a1 b1 c1 d1
+            _mm_store_si128((__m128i *)(d + 2*dst_stride), _mm_unpacklo_epi64(t2,t3));     // a2 b2 c2 d2
+            _mm_store_si128((__m128i *)(d + 3*dst_stride), _mm_unpackhi_epi64(t2,t3));     // a3 b3 c3 d3
+        }
+    }
+#else
+    for (int i = 0; i < MS_TILE; i++) {
+        for (int j = 0; j < MS_TILE; j++) {
+            dst[(size_t)j*dst_stride + i] = src[(size_t)i*src_stride + j];
+        }
+    }
+#endif
+}
+
+/* Function for transposing tile [ti][tj] into tile [tj][ti] & vice versa (a tile on the diagonal, ti == tj, is transposed in place). Goes through an aligned buffer        */
+static inline void transpose_swap_tiles(ms_matrix m, int ti, int tj) {
+    _Alignas(MS_ALIGN) int tmp[MS_TILE*MS_TILE];
+    int *a = &ms_at(m, ti*MS_TILE, tj*MS_TILE), *b = &ms_at(m, tj*MS_TILE, ti*MS_TILE);
+    transpose_tile(a, m.stride, tmp, MS_TILE);
+    if (a != b) {
+        transpose_tile(b, m.stride, a, m.stride);
+    }
+    for (int i = 0; i < MS_TILE; i++) {
+        memcpy(b + (size_t)i*m.stride, tmp + i*MS_TILE, MS_TILE*sizeof(int));
+    }
+}
+
+/* Function for transposing the block of tile rows [r0,r1) x tile columns [c0,c1) (above the diagonal) with its mirror image below the diagonal. Cache-oblivious: the       */
+/* longer side is halved until the block is at most 16 tile pairs (8KB), which is then swapped tile by tile while it's all in L1 - whatever the cache sizes are             */
+static void transpose_swap_block(ms_matrix m, int r0, int r1, int c0, int c1) {
+    if ((r1-r0)*(c1-c0) <= 16) {
+        for (int i = r0; i < r1; i++) {
+            for (int j = c0; j < c1; j++) {
+                transpose_swap_tiles(m,i,j);
+            }
+        }
+    } else if (r1-r0 >= c1-c0) {
+        int mid = r0 + (r1-r0)/2;
+        transpose_swap_block(m,r0,mid,c0,c1);
+        transpose_swap_block(m,mid,r1,c0,c1);
+    } else {
+        int mid = c0 + (c1-c0)/2;
+        transpose_swap_block(m,r0,r1,c0,mid);
+        transpose_swap_block(m,r0,r1,mid,c1);
+    }
+}
+
+/* Function for transposing the tiles [t0,t1) x [t0,t1) on the diagonal. Splits them into quadrants: the two diagonal ones are transposed recursively, the other two        */
+/* are transposed into each other                                                                                                                                           */
+static void transpose_diagonal(ms_matrix m, int t0, int t1) {
+    if (t1-t0 == 1) {
+        transpose_swap_tiles(m,t0,t0);
+        return;
+    }
+    int mid = t0 + (t1-t0)/2;
+    transpose_diagonal(m,t0,mid);
+    transpose_diagonal(m,mid,t1);
+    transpose_swap_block(m,t0,mid,mid,t1);
+}
+
+/* Function for transposing the matrix: [i][j] <-swap-> [j][i]. Whole tiles go through the tiled kernels; the columns past the last whole tile (n%MS_TILE of them)          */
+/* are swapped with the matching rows one element at a time                                                                                                                 */
+static void transpose_matrix(ms_matrix m) {
+    int tiles = m.n/MS_TILE, edge = tiles*MS_TILE;
+    if (tiles) {
+        transpose_diagonal(m,0,tiles);
+    }
+    for (int i = 0; i < m.n; i++) {
+        int *row = &ms_at(m,i,0);
+        for (int j = (i+1 > edge) ? i+1 : edge; j < m.n; j++) {
+            swap(row[j],ms_at(m,j,i));
+        }
+    }
+}
+
+/* Function for adding amount to count ints, saturating at INT_MIN/INT_MAX instead of wrapping. Returns true if any of them saturated. With SSE2, 4 ints at a               */
+/* time: a sum overflowed when its sign differs from the signs of both operands ((x^r) & (amount^r) negative)                                                               */
+static inline bool add_row(int *row, int count, int amount) {
+    bool overflow = false;
+    int j = 0;
+#if defined(__SSE2__)
+    __m128i add = _mm_set1_epi32(amount), limit = _mm_set1_epi32(amount < 0 ? INT_MIN : INT_MAX);
+    __m128i over = _mm_setzero_si128();
+    for (; j+4 <= count; j += 4) {
+        __m128i x = _mm_load_si128((__m128i *)(row+j)), r = _mm_add_epi32(x,add);                 // rows are MS_ALIGN aligned
+        __m128i o = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(x,r), _mm_xor_si128(add,r)), 31);   // all ones where the sum overflowed
+        r = _mm_or_si128(_mm_andnot_si128(o,r), _mm_and_si128(o,limit));
+        _mm_store_si128((__m128i *)(row+j), r);
+        over = _mm_or_si128(over,o);
+    }
+    overflow = _mm_movemask_epi8(over);
+#endif
+    for (; j < count; j++) {
+        long long r = (long long)row[j] + amount;
+        if (r > INT_MAX || r < INT_MIN) {
+            overflow = true, r = (r > INT_MAX) ? INT_MAX : INT_MIN;
+        }
+        row[j] = (int)r;
+    }
+    return overflow;
+}
+
+/* Struct for one thread's share of flip_add_matrix: row pairs [first,last), where pair i is rows i & n-i-1, & whether any of the numbers it produced overflowed */
+typedef struct {
+    ms_matrix m;
+    bool flip_rows, flip_cols;
+    int offset;
+    int first, last;
+    bool overflow;
+} flip_add_job;
+
+/* Function for reversing the order of the rows (flip_rows) and/or the order within each row (flip_cols) & adding offset to every number, for a job's row pairs.            */
+/* Both rows of a pair are flipped & then have the offset added while they're in cache, so the whole transform is a single pass                                             */
+static void *flip_add_rows(void *arg) {
+    flip_add_job *job = arg;
+    ms_matrix m = job->m;
+    for (int i = job->first; i < job->last; i++) {
+        int k = m.n-i-1, *top = &ms_at(m,i,0), *bottom = &ms_at(m,k,0);
+        if (job->flip_rows && job->flip_cols) {
+            swap_reversed(top, bottom+m.n, (i == k) ? m.n/2 : m.n);         // [i][j] <-swap-> [n-i-1][n-j-1] (the middle row of odd n only reverses itself)
+        } else if (job->flip_rows) {
+            for (int j = 0; j < m.n; j++) {
+                swap(top[j],bottom[j]);                                     // [i][j] <-swap-> [n-i-1][j]
+            }
+        } else if (job->flip_cols) {
+            swap_reversed(top, top+m.n, m.n/2);                             // [i][j] <-swap-> [i][n-j-1]
+            if (i != k) swap_reversed(bottom, bottom+m.n, m.n/2);
+        }
+        if (job->offset) {
+            job->overflow |= add_row(top, m.n, job->offset);
+            if (i != k) job->overflow |= add_row(bottom, m.n, job->offset);
+        }
+    }
+    return NULL;
+}
+
+/* Function for flipping the matrix & adding offset to every number (see flip_add_rows). Squares of at least PARALLEL_MIN numbers are split across one thread per           */
+/* online processor (a thread that can't be started leaves its share to the calling thread). Returns true if any number overflowed an int (& was saturated)                 */
+static bool flip_add_matrix(ms_matrix m, bool flip_rows, bool flip_cols, int offset) {
+    int pairs = (m.n+1)/2, threads = 1;
+    if ((long long)m.n*m.n >= PARALLEL_MIN) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (online < 1) ? 1 : (online > pairs) ? pairs : (int)online;
+    }
+    flip_add_job jobs[threads];
+    pthread_t workers[threads];
+    bool started[threads];
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (flip_add_job){ m, flip_rows, flip_cols, offset, (int)((long long)pairs*t/threads), (int)((long long)pairs*(t+1)/threads), false };
+        started[t] = (t > 0) && !pthread_create(&workers[t], NULL, flip_add_rows, &jobs[t]);
+    }
+    bool overflow = false;
+    for (int t = 0; t < threads; t++) {
+        if (started[t]) pthread_join(workers[t], NULL);
+        else flip_add_rows(&jobs[t]);
+        overflow |= jobs[t].overflow;
+    }
+    return overflow;
+}
 
 /*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
 /* Function Definitions: */
@@ -82,8 +403,8 @@ int *get_size(void) {
         clear_stdin();
         printf(RED"Invalid Input: Non-integer value\n"DEFAULT);                 // If non-integer input: clear stdin, print error & return null
         return NULL;
-    } else if ((*size < MIN_SIZE) || even(*size) || (*size > MAX_SIZE)) {   // Verify size is within set range (1-11) and is an odd integer
-        printf(RED"Invalid Input: %d\n"DEFAULT,*size);                          // If input is outside range or is even: print error & return null
+    } else if ((*size < MIN_SIZE) || (*size == 2) || (*size > MAX_SIZE)) {  // Verify size is within set range (1-46340) and isn't 2 (there's no 2x2 magic square)
+        printf(RED"Invalid Input: %d\n"DEFAULT,*size);                          // If input is outside range or is 2: print error & return null
         return NULL;
     } else {
         return size;                                                        // Otherwise, input is valid: return size pointer
@@ -91,48 +412,76 @@ int *get_size(void) {
 }
 
 /* **************************************************************************************************************************************************************************
- * Create Magic Square - Allocate pointer so it can be indexed as an nxn array & fill in magic numbers.                                                                    *
- * Filling Magic Square: If element unoccupied, save value (i) there, then move to next position (one row down and one column right).                                       *
- * Otherwise, element occupied, save value (i) one row below the previous position, then move to next position (which will be one row below the current position).          *
- * Note: See EOF for more info on filling the magic square.                                                                                                                 *
+ * Create Magic Square - Allocate contiguous storage, with row pointers so it can be indexed as an nxn array, & fill in magic numbers.                                      *
+ * Filling Magic Square: Odd squares use the Siamese method, doubly-even squares (n divisible by 4) complement the 4x4 block diagonals & singly-even squares use the LUX    *
+ * method. Every fill writes each element once, row by row, in O(n^2). Note: See top of file for more info on filling the magic square.                                     *
  * *************************************************************************************************************************************************************************/
 int **create_ms(int n) {
-    /* Allocate array and return null if any calloc calls fail */
-    int **ms = alloc(n,*ms);            // allocate array of n pointers & save address
-    if (!ms) {
+    /* Allocate one MS_ALIGN aligned block: the state (MS_ALIGN bytes), n row pointers (padded to MS_ALIGN bytes) & n rows of stride ints. Return null if it fails */
+    int stride = get_stride(n);
+    size_t pointers = ((size_t)n*sizeof(int *) + MS_ALIGN-1) / MS_ALIGN * MS_ALIGN;
+    char *block = aligned_alloc(MS_ALIGN, MS_ALIGN + pointers + (size_t)n*stride*sizeof(int));
+    if (!block) {
         return NULL;
-    } else {
-        for (int i = 0; i < n; i++) {   // allocate space for each row's buckets and save addresses
-            ms[i] = alloc(n,*ms[i]);
-            if (!ms[i]) {
-                free_ms(ms,i);          // free used memory & return null if any calloc call fails
-                return NULL;
-            }
-        }
     }
-    /* Fill magic square- 1st position: ms[0][n/2]. */
-    /* To move up 1 row (or 1 column right): decrement by 1 (or add n-1). Modulus used for controlling wrap arounds. */
-    /* To move 1 column left (or 1 row down): increment by 1. Modulus used for controlling wrap arounds. */
-    for (int i = 1, r = 0, c = n/2; i <= n*n; i++) { /* If occupied: save value, adjust r, adjust c. Else: save value (2 rows down & 1 column left), adjust r. */
-        (!ms[r][c]) ? (ms[r][c] = i, r = (r+n-1)%n, c = (c+1)%n) : (ms[(r+2)%n][(c+n-1)%n] = i, r = (r+1)%n);
+    int **ms = (int **)(block + MS_ALIGN);
+    *get_state(ms) = (ms_state){ 0, 0, 0 };
+    /* Point each row pointer at its row, so the block can be indexed as an nxn array. Clear the padding at the end of each row */
+    int *data = (int *)((char *)ms + pointers);
+    for (int i = 0; i < n; i++) {
+        ms[i] = data + (size_t)i*stride;
+        memset(ms[i]+n, 0, (size_t)(stride-n)*sizeof(int));
     }
+    /* Fill magic square */
+    fill_ms(ms,n);
     return ms;
 }
 
 /* **************************************************************************************************************************************************************************
- * Frees Magic Square - Frees magic square memory (in the opposite order it was allocated).                                                                                 *
+ * Frees Magic Square - Frees magic square memory. The state, row pointers & rows are one block, so a single free releases all of them.                                     *
  * *************************************************************************************************************************************************************************/
 void free_ms(int **ms, int n) {
-    for (int i = 0; i < n; i++) {
-        free(ms[i]);                    // free each row first
+    (void)n;                            // kept for compatibility with callers written for separately allocated rows
+    free(get_state(ms));
+}
+
+/* **************************************************************************************************************************************************************************
+ * Materialize Magic Square - Applies the magic square's pending transforms & increases/decreases (see ms_state) to its numbers, so that ms[i][j] is the current            *
+ * square. However many operations are pending, this is at most one tiled transpose & one (threaded, for large squares) pass that flips rows/columns & adds the offset      *
+ * together. The increase/decrease functions keep the numbers within an int, but numbers written directly through ms[i][j] may not be: if adding the offset would           *
+ * overflow one, it's saturated at INT_MIN/INT_MAX & false is returned.                                                                                                     *
+ * *************************************************************************************************************************************************************************/
+bool materialize_ms(int **ms, int n) {
+    ms_state *state = get_state(ms);
+    if (!state->view && !state->offset) {
+        return true;
+    }
+    ms_matrix m = get_storage(ms,n);
+    bool swapped = state->view & VIEW_SWAP;
+    if (swapped) {
+        transpose_matrix(m);                                                // a transposed view's flips apply to the other index
     }
-    free(ms);                           // then free array of row pointers
+    bool overflow = flip_add_matrix(m, state->view & (swapped ? VIEW_FLIP_J : VIEW_FLIP_I), state->view & (swapped ? VIEW_FLIP_I : VIEW_FLIP_J), state->offset);
+    state->view = 0, state->offset = 0;
+    return !overflow;
+}
+
+/* **************************************************************************************************************************************************************************
+ * Get Magic Square Matrix - Returns the contiguous storage behind the magic square (see ms_matrix), for code that wants to walk it directly rather than through            *
+ * the row pointers. Materializes the magic square first, so the storage holds the current numbers.                                                                         *
+ * *************************************************************************************************************************************************************************/
+ms_matrix get_matrix_ms(int **ms, int n) {
+    materialize_ms(ms,n);
+    return get_storage(ms,n);
 }
 
 /* **************************************************************************************************************************************************************************
- * Print Magic Square - Prints the magic square. (Magic square printed in cyan)                                                                                             *
+ * Print Magic Square - Materializes & prints the magic square. (Magic square printed in cyan)                                                                              *
  * *************************************************************************************************************************************************************************/
 void print_ms(int **ms,int n) {
+    if (!materialize_ms(ms,n)) {
+        printf(RED"Warning! Magic numbers overflowed an int & were saturated.\n"KCYN);
+    }
     for (int i = 0; i < n*n; i++) {
         printf("%6.0d%s",ms[i/n][i%n],(i%n==n-1) ? "\n" : "");  // print newline when element is last in its row (when i%n=n-1)
     }
@@ -140,142 +489,82 @@ void print_ms(int **ms,int n) {
 
 /* **************************************************************************************************************************************************************************
  * Sum Magic Numbers - Sums all the magic square's numbers using explicit formula for sum of consecutive integers n(n+1)/2 where n = n^2. Since magic numbers may have been *
- * increased or changed position, the original value of center number (which never moves) for the nxn magic square is calculated using the formula:                         *
- * center = n*(n/2) + ((n/2)+1). The difference between the current center value and original center value is then found and multiplied by n^2, to account for any increase *
- * in the values. The final formula for the sum is: sum = (n^2*(n^2+1) / 2) + ( (ms[n/2][n/2] - (n * floor(n/2) + ceiling(n/2)) ) * n^2).                                   *
+ * increased, the increase (tracked in the magic square's state, see get_increase) is multiplied by n^2 and added. The final formula for the sum is:                        *
+ * sum = (n^2*(n^2+1) / 2) + (increase * n^2). Returned as a long long, since the sum overflows an int for n > 215.                                                         *
  * *************************************************************************************************************************************************************************/
-int sum_ms(int **ms, int n) {
-    return ((n*n*((n*n)+1))/2) + ((ms[n/2][n/2] - (n*(n/2) + ((n/2)+1)))*(n*n));
+long long sum_ms(int **ms, int n) {
+    long long n2 = (long long)n*n;
+    return (n2*(n2+1))/2 + get_increase(ms,n)*n2;
 }
 
 /* **************************************************************************************************************************************************************************
  * Reverse Rows of Magic Square - Reverses each row of the nxn magic square array to create a new magic square.                                                             *
  * *************************************************************************************************************************************************************************/
 void reverse_rows_ms(int **ms, int n) {
-    for (int i = 0; i < n; i++) {           // outer loop runs n iterations (one for each row)
-        for (int j = 0; j < (n/2); j++) {   // inner loop runs n/2 iterations for each row. n/2 swaps take place within each row
-            swap(ms[i][j],ms[i][n-j-1]);    // [0][0] <-swap-> [0][n-1], [0][1] <-swap-> [0][n-2],...etc.
-        }
-    }
+    (void)n;
+    view_ms(ms, VIEW_FLIP_J);                                             // new [i][j] = old [i][n-j-1]
 }
 
 /* **************************************************************************************************************************************************************************
  * Reverse Columns of Magic Square - Reverses each column of the nxn magic square array to create a new magic square.                                                       *
  * *************************************************************************************************************************************************************************/
 void reverse_columns_ms(int **ms, int n) {
-    for (int i = 0; i < n; i++) {           // out loop runs n iterations (one for each column)
-        for (int j = 0; j < (n/2); j++) {   // inner loop runs n/2 iterations for each column. n/2 swaps take place within each col
-            swap(ms[j][i],ms[n-j-1][i]);    // [0][0] <-swap-> [n-1][0], [1][0] <-swap-> [n-2][0],...etc.
-        }
-    }
+    (void)n;
+    view_ms(ms, VIEW_FLIP_I);                                             // new [i][j] = old [n-i-1][j]
 }
 
 /* **************************************************************************************************************************************************************************
  * Rotate Magic Square 90 Degrees - Rotates the magic square 90 degrees to create a new magic square.                                                                       *
  * *************************************************************************************************************************************************************************/
 void rotate_90_ms(int **ms, int n) {
-    /* Transpose nxn magic square array */
-    for (int i = 0; i < n; i++) {           // outer loop runs n iterations
-        for (int j = i+1; j < n; j++) {     // inner loop runs n-1 iterations, then n-2, then n-3,...,then n-a, etc. (where n-a > 0).
-            swap(ms[i][j],ms[j][i]);        // [0][1] <-swap-> [1][0], [0][2] <-swap-> [2][0],...etc.
-        }
-    }
-    /* Reverse each row */
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < (n/2); j++) {
-            swap(ms[i][j],ms[i][n-j-1]);
-        }
-    }
+    (void)n;
+    view_ms(ms, VIEW_SWAP | VIEW_FLIP_I);                                 // new [i][j] = old [n-j-1][i] (transpose, then reverse each row)
 }
 
 /* **************************************************************************************************************************************************************************
  * Rotate Magic Square 180 Degrees - Rotates the magic square 180 degrees (reverses it) to create a new magic square.                                                       *
  * *************************************************************************************************************************************************************************/
 void rotate_180_ms(int **ms, int n) {
-    /* Reverse each row by swapping the corresponding elements */
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < (n/2); j++) {
-            swap(ms[i][j],ms[i][n-j-1]);
-        }
-    }
-    /* Reverse each column by swapping the corresponding elements */
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < (n/2); j++) {
-            swap(ms[j][i],ms[n-j-1][i]);
-        }
-    }
+    (void)n;
+    view_ms(ms, VIEW_FLIP_I | VIEW_FLIP_J);                               // new [i][j] = old [n-i-1][n-j-1]
 }
 
 /* **************************************************************************************************************************************************************************
  * Rotate Magic Square 270 Degrees - Rotates the magic square 270 degrees to create a new magic square.                                                                     *
  * *************************************************************************************************************************************************************************/
 void rotate_270_ms(int **ms, int n) {
-    /* Transpose nxn magic square array */
-    for (int i = 0; i < n; i++) {
-        for (int j = i+1; j < n; j++) {
-            swap(ms[i][j],ms[j][i]);
-        }
-    }
-    /* Reverse each column */
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < (n/2); j++) {
-            swap(ms[j][i],ms[n-j-1][i]);
-        }
-    }
+    (void)n;
+    view_ms(ms, VIEW_SWAP | VIEW_FLIP_J);                                 // new [i][j] = old [j][n-i-1] (transpose, then reverse each column)
 }
 
 /* **************************************************************************************************************************************************************************
  * Transpose Magic Square - Transposes (reflect over primary diagonal) the magic square to create a new magic square.                                                       *
  * *************************************************************************************************************************************************************************/
 void transpose_ms(int **ms, int n) {
-    /* Transpose the nxn magic square array */
-    for (int i = 0; i < n; i++) {
-        for (int j = i+1; j < n; j++) {
-            swap(ms[i][j],ms[j][i]);
-        }
-    }
+    (void)n;
+    view_ms(ms, VIEW_SWAP);                                               // new [i][j] = old [j][i]
 }
 
 /* **************************************************************************************************************************************************************************
- * Reverse Transpose Magic Square - Transposes the magic square backwards (reflect over secondary diagonal) to create a new magic square.                                  *
+ * Reverse Transpose Magic Square - Transposes the magic square backwards (reflect over secondary diagonal) to create a new magic square.                                   *
  * *************************************************************************************************************************************************************************/
 void transpose_r_ms(int **ms, int n) {
-    /* Reverse each row */
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < (n/2); j++) {
-            swap(ms[i][j],ms[i][n-j-1]);
-        }
-    }
-    /* Reverse each column */
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < (n/2); j++) {
-            swap(ms[j][i],ms[n-j-1][i]);
-        }
-    }
-    /* Transpose nxn magic square array */
-    for (int i = 0; i < n; i++) {
-        for (int j = i+1; j < n; j++) {
-            swap(ms[i][j],ms[j][i]);
-        }
-    }
+    (void)n;
+    view_ms(ms, VIEW_SWAP | VIEW_FLIP_I | VIEW_FLIP_J);                   // new [i][j] = old [n-j-1][n-i-1]
 }
 
 /* **************************************************************************************************************************************************************************
  * Increase Magic Square - Increases all numbers in the magic square by a given amount to create a new magic square.                                                        *
  * Find the largest number in the magic square (current_max) to make sure the increase won't cause any numbers to exceed the upper limit (MAX_MAGIC_NUMBER).                *
- * Since we don't know if the magic square has been transformed or not, uses the center number (which never moves) to determine the largest number in the magic square.     *
+ * Since we don't know if the magic square has been transformed or not, uses the increase tracked in its state to determine the largest number in the magic square.         *
  * *************************************************************************************************************************************************************************/
 void increase_ms(int **ms, int n) {
     int current_max = get_current_largest(ms,n), amount;
     if (current_max != MAX_MAGIC_NUMBER) {                                      // Make sure magic numbers are below max values, display error if not
         printf("Enter amount to increase magic square values by: ");            // Prompt user for increase amount
         if ((scanf("%d",&amount)) && getchar()=='\n') {                         // Make sure the input was valid, display error & clear stdin if not
-            if ((current_max+amount <= MAX_MAGIC_NUMBER) && (amount > 0)) {     // Make sure amount is valid (positive & keeps values below max), display error if not
-                for (int i = 0; i < n; i++) {
-                    for (int j = 0; j < n; j++) {
-                        ms[i][j] += amount;                                     // If all conditions pass, increase magic numbers by amount
-                    }
-                }
+            if ((amount <= MAX_MAGIC_NUMBER-current_max) && (amount > 0)) {     // Make sure amount is valid (positive & keeps values below max), display error if not
+                add_ms(ms, amount);                                             // If all conditions pass, increase magic numbers by amount
             } else printf(RED"\nError! Invalid amount (positive amounts only). Max magic number limit: %d\n"DEFAULT,MAX_MAGIC_NUMBER);
         } else printf(RED"\nError! Invalid input.\n"DEFAULT), clear_stdin();
     } else printf(RED"\nError! Values at maximum. Maximum allowed magic number: %d\n"DEFAULT,MAX_MAGIC_NUMBER);
@@ -284,19 +573,15 @@ void increase_ms(int **ms, int n) {
 /* **************************************************************************************************************************************************************************
  * Decrease Magic Square -  Decreases all numbers in the magic square by a given amount to create a new magic square (magic square needs to have been increased).           *
  * Makes sure the decrease amount won't cause any of the magic numbers to go below the lower limit, 1 (MIN_MAGIC NUMBER).                                                   *
- * Since we don't know if the magic square has been transformed or not, uses the center number (which never moves) to verify this.                                          *
+ * Since we don't know if the magic square has been transformed or not, uses the increase tracked in its state to verify this.                                              *
  * *************************************************************************************************************************************************************************/
 void decrease_ms(int **ms, int n) {
-    int default_center = get_original_center(n), current_center = get_current_center(ms,n), amount;
-    if (current_center != default_center) {                                     // Make sure magic numbers are above min (original) values, display error if not
+    int increase = get_increase(ms,n), amount;
+    if (increase) {                                                             // Make sure magic numbers are above min (original) values, display error if not
         printf("Enter amount to decrease magic square values by: ");            // Prompt user for decrease amount
         if ((scanf("%d",&amount)) && getchar()=='\n') {                         // Make sure input is valid, display error & clear stdin if not
-            if ((current_center-amount > default_center) && (amount > 0)) {     // Make sure amount is valid (positive & keeps values above min), display error if not
-                for (int i = 0; i < n; i++) {
-                    for (int j = 0; j < n; j++) {
-                        ms[i][j] -= amount;                                     // If all conditions pass, decrease magic numbers by amount
-                    }
-                }
+            if ((increase-amount > 0) && (amount > 0)) {                        // Make sure amount is valid (positive & keeps values above min), display error if not
+                add_ms(ms, -amount);                                            // If all conditions pass, decrease magic numbers by amount
             } else printf(RED"\nError! Invalid amount (positive amounts only). Min magic number limit: %d\n"DEFAULT,MIN_MAGIC_NUMBER);
         } else printf(RED"\nError! Invalid input.\n"DEFAULT), clear_stdin();
     } else printf(RED"\nError! Values at minimum. Minimum allowed magic number: %d\n"DEFAULT,MIN_MAGIC_NUMBER);
@@ -310,12 +595,8 @@ void random_increase_ms(int **ms, int n) {
     int current_max = get_current_largest(ms,n), amount;
     if (current_max != MAX_MAGIC_NUMBER) {                  // If values not already at a maximum, seed random number generator, generate random, increase all values
         time_t t; srand((unsigned) time(&t));               // If the random num will cause any value to go above MAX_MAGIC_NUMBER, generate new random num
-        while (((amount = MIN_RAND + rand() % MAX_RAND) + (current_max)) > MAX_MAGIC_NUMBER);
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                ms[i][j] += amount;                         // Once an acceptable value is generated, increase all values by that amount
-            }
-        }                                                   // Otherwise, values already at maximum, print error
+        while ((amount = MIN_RAND + rand() % MAX_RAND) > MAX_MAGIC_NUMBER - current_max);
+        add_ms(ms, amount);                                 // Once an acceptable value is generated, increase all values by that amount
     } else printf(RED"\nError! Values at maximum. Maximum allowed magic number: %d\n"DEFAULT,MAX_MAGIC_NUMBER);
 }
 
@@ -324,15 +605,11 @@ void random_increase_ms(int **ms, int n) {
  * Verifies no values in the magic square will exceed go below 1 the same way 'Decrease Magic Square' function does.                                                        *
  * *************************************************************************************************************************************************************************/
 void random_decrease_ms(int **ms, int n) {
-    int default_center = get_original_center(n), current_center = get_current_center(ms,n), amount;
-    if (current_center != default_center) {                 // If values not already at a minimum, seed random number generator, generate random, decrease all values
+    int increase = get_increase(ms,n), amount;
+    if (increase) {                                         // If values not already at a minimum, seed random number generator, generate random, decrease all values
         time_t t; srand((unsigned) time(&t));               // If the random num will cause any value to go below 1, generate a new random number */
-        while ((amount = MIN_RAND + rand() % MAX_RAND) > (current_center - default_center));
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                ms[i][j] -= amount;                         // Once an acceptable value is generated, increase all values by that amount
-            }
-        }                                                   // Otherwise, values already at minimum, print error
+        while ((amount = MIN_RAND + rand() % MAX_RAND) > increase);
+        add_ms(ms, -amount);                                // Once an acceptable value is generated, decrease all values by that amount
     } else printf(RED"\nError! Values at minimum. Minimum allowed magic number: %d\n"DEFAULT,MIN_MAGIC_NUMBER);
 }
 
@@ -342,11 +619,7 @@ void random_decrease_ms(int **ms, int n) {
 void max_increase_ms(int **ms, int n) {
     int amount = get_max_increase(ms,n);
     if (amount) {                                           // If amount != 0, increase each value by max amount
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                ms[i][j] += amount;
-            }
-        }                                                   // Otherwise, amount==0 (values already at maximum), print error
+        add_ms(ms, amount);
     } else printf(RED"\nError! Values at maximum. Maximum allowed magic number: %d\n"DEFAULT,MAX_MAGIC_NUMBER);
 }
 
@@ -356,11 +629,7 @@ void max_increase_ms(int **ms, int n) {
 void max_decrease_ms(int **ms, int n) {
     int amount = get_max_decrease(ms,n);
     if (amount) {                                           // If amount != 0, decrease each value by maximum amount
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                ms[i][j] -= amount;
-            }
-        }                                                   // Otherwise, amount==0 (values already at minimum/original), print error
+        add_ms(ms, -amount);
     } else printf(RED"\nError! Values at minimum. Minimum allowed magic number: %d\n"DEFAULT,MIN_MAGIC_NUMBER);
 }
 
@@ -368,14 +637,9 @@ void max_decrease_ms(int **ms, int n) {
  * Reset Magic Square - Resets the magic square to it's original state by refilling it                                                                                      *
  * *************************************************************************************************************************************************************************/
 void reset_ms(int **ms, int n) {
-    /* Reset all values to zero */
-    for (int i = 0; i < n*n; i++) {
-        ms[i/n][i%n] = 0;
-    }
-    /* Re-fill the magic square (same way it was created) */
-    for (int i = 1, r = 0, c = n/2; i <= n*n; i++) {
-        (!ms[r][c]) ? (ms[r][c] = i, r = (r+n-1)%n, c = (c+1)%n) : (ms[(r+2)%n][(c+n-1)%n] = i, r = (r+1)%n);
-    }
+    /* Re-fill the magic square (same way it was created). Every element is overwritten, so there's no need to clear it first. Drop any pending transforms/increases */
+    fill_ms(ms,n);
+    *get_state(ms) = (ms_state){ 0, 0, 0 };
 }
 
 /* **************************************************************************************************************************************************************************
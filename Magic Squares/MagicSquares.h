@@ -6,6 +6,8 @@
 #ifndef MagicSquares_h
 #define MagicSquares_h
 
+#include <stdbool.h>
+
 /*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
 /* Macros: */
 
@@ -22,14 +24,33 @@
     #define RED ""
 #endif
 
-/* Macro for swapping two distinct variables of the same type (XOR swap) */
-#define swap(a, b) (a ^= b ^= a ^= b)
+/* Macro for swapping two variables of the same type (through a temporary, which unlike an XOR swap also works when a and b are the same & lets loops vectorize)            */
+#define swap(a, b) do { typeof(a) swap_tmp_ = (a); (a) = (b); (b) = swap_tmp_; } while (0)
 
 /* Macro for calloc */
 #define alloc(n,ptr) (typeof(ptr)*)calloc(n,sizeof(ptr))
 
 /* Macro for even integer test (even: true, odd: false) */
 #define even(n) (n%2 ? 0 : 1)
+
+/* Macro for the alignment (in bytes) of magic square rows. Rows are padded to a multiple of it, so each one starts on its own cache line */
+#define MS_ALIGN 64
+
+/* Macro for the side (in ints) of the square tiles the transpose kernels work on. A row of a tile is 32 bytes: it never straddles a cache line */
+#define MS_TILE 8
+
+/* Macro for accessing element [i][j] of an ms_matrix */
+#define ms_at(m, i, j) ((m).data[(size_t)(i)*(m).stride + (j)])
+/*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
+/* Types: */
+
+/* Contiguous storage of an nxn magic square. All n rows live in one MS_ALIGN aligned block, row i starting at data + i*stride.                                             */
+/* The int ** returned by create_ms points at row pointers into this block, so ms[i][j] keeps working alongside it.                                                         */
+typedef struct {
+    int *data;                  // first element of row 0
+    int n;                      // size of the magic square
+    int stride;                 // ints from the start of one row to the start of the next (n rounded up to a multiple of MS_ALIGN/sizeof(int))
+} ms_matrix;
 /*--------------------------------------------------------------------------------------------------------------------------------------------------------------------------*/
 /* Prototypes: */
 
@@ -40,11 +61,16 @@ int *get_size(void);
 int **create_ms(int n);
 void free_ms(int **ms, int n);
 
+/* Prototypes for Magic Square Storage Functions. Transforms & increases/decreases are applied lazily: call materialize_ms (print_ms & get_matrix_ms do) before             */
+/* reading ms[i][j] directly */
+bool materialize_ms(int **ms, int n);
+ms_matrix get_matrix_ms(int **ms, int n);
+
 /* Prototypes for Print Magic Square Function*/
 void print_ms(int **ms, int n);
 
 /* Prototype for Sum Magic Numbers Function */
-int sum_ms(int **ms, int n);
+long long sum_ms(int **ms, int n);
 
 /* Prototypes for Reversing Magic Square Functions */
 void reverse_rows_ms(int **ms, int n);
@@ -2,7 +2,7 @@
  * Dave Dorzback                                                                                                                                                            *
  * main.c                                                                                                                                                                   *
  *                                                                                                                                                                          *
- * Program for creating and manipulating odd nxn magic squares.                                                                                                             *
+ * Program for creating and manipulating nxn magic squares (of any order except 2).                                                                                         *
  * =========================================================================================================================================================================*/
 
 #include <stdio.h>
@@ -51,7 +51,7 @@ int main(void) {
         menuOptions[0]();
         printf(KCYN);
         print_ms(magic_square, *n);
-        printf("Sum of Magic Numbers: %d\n", sum_ms(magic_square, *n));
+        printf("Sum of Magic Numbers: %lld\n", sum_ms(magic_square, *n));
         printf(MAG"Enter an option or any key to quit (0 - 14): ");
         if (!(scanf("%d",&option)) || getchar()!='\n' || option <= 0 || option > 14) {
             break;                                                          // Break if invalid input is entered
@@ -0,0 +1,531 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strbench.c                                                                                                              *
+ *                                                                                                                         *
+ * Benchmarks every public function of strings.h against the matching glibc function (or the obvious libc loop where       *
+ * glibc has none, and nothing where there is no equivalent at all). Each function runs over a set of strings drawn from   *
+ * a length distribution, starting at a given offset from a 64 byte boundary, and - for searches, comparisons and          *
+ * palindromes - with a given share of hits (needle present, strings equal, string a palindrome). Times are the best of    *
+ * three runs, reported as ns per input byte and GB/s. The strhash.h hashes run on keys of fixed lengths instead and are   *
+ * reported as ns per key.                                                                                                 *
+ *                                                                                                                         *
+ * Build (from this directory):                                                                                            *
+ *     gcc -O2 strbench.c ../strings.c ../strhash.c -lm -pthread -o strbench      (add -march=native for a tuned build)    *
+ * Run: ./strbench [filter]          Only functions whose name contains filter, e.g. ./strbench Cmp                        *
+ * ======================================================================================================================= */
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include "../strings.h"
+#include "../strhash.h"
+
+#define SET_BYTES (2 << 20)             // Input bytes per string set: big enough to leave L1/L2, small enough for L3
+#define SET_MAX_COUNT 100000            // Most strings in one set (keeps the pointer arrays of short-string sets small)
+#define KEY_SET_MAX_COUNT 4096          // Most keys in one hashing set, so short keys are timed from cache
+#define RUN_SECONDS 0.01                // Minimum duration of one timed run
+
+/* *************************************************** TYPEDEFS ************************************************************/
+typedef enum { SCAN, PAIR, SEARCH, PAL, PERM, KEY } _Kind;
+
+typedef struct {                        /* Struct holding one set of benchmark strings */
+    char **strs;                        // Inputs
+    char **subs;                        // Second operand: the string to compare with, or the needle to search for
+    char **dests;                       // Output buffers (2 * length + 64 bytes), initially a copy of the input
+    size_t *lens;                       // strlen(strs[i])
+    bool *flags;                        // Result array for the ...All functions
+    size_t count, bytes;                // Number of strings, total input bytes
+    char *pool;                         // Backing memory
+} _Set;
+
+typedef size_t (*_BenchFn)(const _Set *set);
+
+typedef struct {                        /* Struct describing one benchmarked function */
+    const char *name;
+    _Kind kind;
+    size_t max_len;                     // Skip distributions with longer strings (0 = no limit), for superlinear functions
+    _BenchFn ours;
+    const char *libc_name;              // NULL if there is nothing to compare with
+    _BenchFn libc;
+} _Bench;
+
+static const struct { const char *name; size_t lo, hi; } _dists[] = {
+    { "1-16", 1, 16 }, { "16-256", 16, 256 }, { "4K", 4096, 4096 }, { "1M", 1 << 20, 1 << 20 }
+};
+static const size_t _aligns[] = { 0, 5 };
+static const int _hit_percents[] = { 0, 50, 100 };
+static const size_t _key_lens[] = { 8, 16, 32, 64, 256, 4096 };
+
+static FILE *_devnull = NULL;
+
+/* =========================================================================================================================
+ * _now - Monotonic time in seconds
+ * ========================================================================================================================*/
+
+static double _now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* =========================================================================================================================
+ * _set_create - Builds count strings with lengths from dist, each starting 'align' bytes past a 64 byte boundary. Inputs
+ * use the letters a-y in both cases, so a needle containing 'z' only occurs where it was planted (hit_percent of the
+ * strings). For PAIR sets the second string is a copy (a hit) or differs in one random position
+ * ========================================================================================================================*/
+
+static char *_slot(char **pool, size_t len, size_t align) {
+    char *p = (char *)(((uintptr_t)*pool + 63) & ~(uintptr_t)63) + align;
+    *pool = p + len + 1;
+    return p;
+}
+
+static void _set_create(_Set *set, _Kind kind, size_t lo, size_t hi, size_t align, int hit_percent) {
+    size_t count = SET_BYTES / ((lo + hi) / 2), max_count = kind == KEY ? KEY_SET_MAX_COUNT : SET_MAX_COUNT;
+    count = count < 1 ? 1 : count > max_count ? max_count : count;
+    set->count = count, set->bytes = 0;
+    set->strs = malloc(count * sizeof(char *)), set->subs = malloc(count * sizeof(char *));
+    set->dests = malloc(count * sizeof(char *)), set->lens = malloc(count * sizeof(size_t));
+    set->flags = malloc(count * sizeof(bool));
+    set->pool = malloc(count * (4 * hi + 4 * 128 + 16));
+    char *pool = set->pool;
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = lo + (hi > lo ? (size_t)rand() % (hi - lo + 1) : 0);
+        bool hit = rand() % 100 < hit_percent;
+        char *s = _slot(&pool, len, align);
+        for (size_t k = 0; k < len; ++k) s[k] = (char)((rand() % 2 ? 'a' : 'A') + rand() % 25);
+        s[len] = '\0';
+        if (kind == PAL && hit) for (size_t k = 0; k < len / 2; ++k) s[len - 1 - k] = s[k];
+
+        size_t m = kind == PAIR ? len : len < 8 ? len : 8;
+        char *t = _slot(&pool, m, align);
+        if (kind == PAIR) {
+            memcpy(t, s, len + 1);
+            if (!hit && len) t[rand() % len] = 'z';
+        } else {
+            for (size_t k = 0; k < m; ++k) t[k] = (char)('a' + rand() % 25);
+            t[m] = '\0';
+            if (m) t[0] = 'z';
+            if (kind == SEARCH && hit && m) memcpy(s + (size_t)rand() % (len - m + 1), t, m);
+        }
+        char *d = _slot(&pool, 2 * len + 64, align);
+        memcpy(d, s, len + 1);
+        set->strs[i] = s, set->subs[i] = t, set->dests[i] = d, set->lens[i] = len;
+        set->bytes += len;
+    }
+    if (!set->bytes) set->bytes = 1;
+}
+
+static void _set_free(_Set *set) {
+    free(set->strs), free(set->subs), free(set->dests), free(set->lens), free(set->flags), free(set->pool);
+}
+
+/* =========================================================================================================================
+ * BENCH - Defines a benchmark function running its body once per string, with s (input), t (second operand/needle), d
+ * (output buffer, 2 * n + 64 bytes) and n (length of s) in scope. The body adds to sum so the work can't be dropped
+ * ========================================================================================================================*/
+
+#define BENCH(fn, ...)                                                                  \
+    static size_t fn(const _Set *set) {                                                 \
+        size_t sum = 0;                                                                 \
+        for (size_t i = 0; i < set->count; ++i) {                                       \
+            char *s = set->strs[i], *t = set->subs[i], *d = set->dests[i];              \
+            size_t n = set->lens[i];                                                    \
+            (void)s, (void)t, (void)d, (void)n;                                         \
+            __VA_ARGS__;                                                                \
+        }                                                                               \
+        return sum;                                                                     \
+    }
+
+/* Baselines built from libc where glibc has no single matching function */
+static char *_libc_fold(char *d, const char *s, size_t n, bool upper) {
+    for (size_t i = 0; i < n; ++i) d[i] = (char)(upper ? toupper((unsigned char)s[i]) : tolower((unsigned char)s[i]));
+    return d;
+}
+
+static size_t _libc_all(char *s, const char *t, bool fold) {
+    size_t count = 0, space = 0, m = strlen(t);
+    char **all = NULL;
+    for (char *p = s; (p = fold ? strcasestr(p, t) : strstr(p, t)); p += m ? m : 1) {
+        if (count + 1 >= space) all = realloc(all, (space = space ? 2 * space : 16) * sizeof(char *));
+        all[count++] = p;
+    }
+    free(all);
+    return count;
+}
+
+static size_t _libc_replace(const char *s, const char *needle, const char *rep, bool fold) {
+    size_t m = strlen(needle), r = strlen(rep), out = 0, count = 0;
+    char *res = malloc(strlen(s) * (r + 1) + 1);
+    for (const char *p; (p = fold ? strcasestr(s, needle) : strstr(s, needle)); s = p + m, ++count) {
+        memcpy(res + out, s, (size_t)(p - s)), out += (size_t)(p - s);
+        memcpy(res + out, rep, r), out += r;
+    }
+    strcpy(res + out, s);
+    free(res);
+    return count;
+}
+
+static size_t _libc_replace_in_place(char *s, const char *needle, const char *rep) {
+    size_t m = strlen(needle), r = strlen(rep), count = 0;
+    char *w = s;
+    for (char *p; (p = strstr(s, needle)); s = p + m, ++count) {
+        memmove(w, s, (size_t)(p - s)), w += p - s;
+        memcpy(w, rep, r), w += r;
+    }
+    memmove(w, s, strlen(s) + 1);
+    return count;
+}
+
+static char *_libc_insert(char *d, size_t n, const char *frag, size_t idx) {
+    size_t m = strlen(frag);
+    memmove(d + idx + m, d + idx, n - idx + 1);
+    return memcpy(d + idx, frag, m);
+}
+
+static int _cmp_uchar(const void *x, const void *y) {
+    return *(const unsigned char *)x - *(const unsigned char *)y;
+}
+
+static StrAllocator _alloc = { NULL, NULL, NULL, 0 };
+
+/* Case conversion */
+BENCH(b_strUpr, sum += (size_t)strUpr(d))
+BENCH(b_strLwr, sum += (size_t)strLwr(d))
+BENCH(b_strnUpr, sum += (size_t)strnUpr(d, n))
+BENCH(b_strnLwr, sum += (size_t)strnLwr(d, n))
+BENCH(l_toupper, sum += (size_t)_libc_fold(d, d, n, true))
+BENCH(l_tolower, sum += (size_t)_libc_fold(d, d, n, false))
+static size_t b_strUprAll(const _Set *set) { return strUprAll(set->dests, set->count); }
+static size_t b_strLwrAll(const _Set *set) { return strLwrAll(set->dests, set->count); }
+
+/* Length and comparison */
+BENCH(b_strLen, sum += strLen(s))
+BENCH(b_strLen_, sum += strLen_(s))
+BENCH(l_strlen, sum += strlen(s))
+BENCH(b_strCmp, sum += (size_t)strCmp(s, t))
+BENCH(b_strCmp_, sum += (size_t)strCmp_(s, t))
+BENCH(l_strcmp, sum += (size_t)strcmp(s, t))
+BENCH(b_strCaseCmp, sum += (size_t)strCaseCmp(s, t))
+BENCH(b_strCaseCmp_, sum += (size_t)strCaseCmp_(s, t))
+BENCH(l_strcasecmp, sum += (size_t)strcasecmp(s, t))
+BENCH(b_strnCmp, sum += (size_t)strnCmp(s, t, (long)n))
+BENCH(b_strnCmp_, sum += (size_t)strnCmp_(s, t, (long)n))
+BENCH(l_strncmp, sum += (size_t)strncmp(s, t, n))
+BENCH(b_strnCaseCmp, sum += (size_t)strnCaseCmp(s, t, (long)n))
+BENCH(b_strnCaseCmp_, sum += (size_t)strnCaseCmp_(s, t, (long)n))
+BENCH(l_strncasecmp, sum += (size_t)strncasecmp(s, t, n))
+
+/* Copies, concatenation and moves */
+BENCH(b_strCpy, sum += (size_t)strCpy(d, s))
+BENCH(l_strcpy, sum += (size_t)strcpy(d, s))
+BENCH(b_strCaseCpy, sum += (size_t)strCaseCpy(d, s))
+BENCH(l_strcpy_lower, sum += (size_t)_libc_fold(d, s, n + 1, false))
+BENCH(b_strnCpy, sum += (size_t)strnCpy(d, s, n))
+BENCH(l_strncpy, sum += (size_t)strncpy(d, s, n))
+BENCH(b_strnCaseCpy, sum += (size_t)strnCaseCpy(d, s, n))
+BENCH(l_strncpy_lower, sum += (size_t)_libc_fold(d, s, n, false))
+BENCH(b_strCat, *d = '\0'; sum += (size_t)strCat(d, s))
+BENCH(l_strcat, *d = '\0'; sum += (size_t)strcat(d, s))
+BENCH(b_strCaseCat, *d = '\0'; sum += (size_t)strCaseCat(d, s))
+BENCH(l_strcat_lower, *d = '\0'; sum += (size_t)_libc_fold(d + strlen(d), s, n + 1, false))
+BENCH(b_strCharCat, sum += (size_t)strCharCat(d, 'q'); d[n] = '\0')
+BENCH(b_strCaseCharCat, sum += (size_t)strCaseCharCat(d, 'Q'); d[n] = '\0')
+BENCH(l_strlen_store, char *e = d + strlen(d); e[0] = 'q', e[1] = '\0'; sum += (size_t)e; d[n] = '\0')
+BENCH(b_strMove, sum += (size_t)strMove(d + 1, d, n))
+BENCH(b_strCaseMove, sum += (size_t)strCaseMove(d + 1, d, n))
+BENCH(l_memmove, sum += (size_t)memmove(d + 1, d, n))
+
+/* Character and substring search */
+BENCH(b_strChr, sum += (size_t)strChr(s, 'z'))
+BENCH(b_strChr_, sum += (size_t)strChr_(s, 'z'))
+BENCH(l_strchr, sum += (size_t)strchr(s, 'z'))
+BENCH(b_strCaseChr, sum += (size_t)strCaseChr(s, 'z'))
+BENCH(b_strCaseChr_, sum += (size_t)strCaseChr_(s, 'z'))
+BENCH(l_strpbrk, sum += (size_t)strpbrk(s, "zZ"))
+BENCH(b_strStr, sum += (size_t)strStr(s, t))
+BENCH(b_strStr_, sum += (size_t)strStr_(s, t))
+BENCH(l_strstr, sum += (size_t)strstr(s, t))
+BENCH(b_strCaseStr, sum += (size_t)strCaseStr(s, t))
+BENCH(b_strCaseStr_, sum += (size_t)strCaseStr_(s, t))
+BENCH(l_strcasestr, sum += (size_t)strcasestr(s, t))
+BENCH(b_strAllStr, char **r = strAllStr(s, t); sum += (size_t)r; free(r))
+BENCH(b_strAllStr_, char **r = strAllStr_(s, t); sum += (size_t)r; free(r))
+BENCH(b_strAllStrWith, char **r = strAllStrWith(&_alloc, s, t); sum += (size_t)r; strFreeWith(&_alloc, r))
+BENCH(l_strstr_all, sum += _libc_all(s, t, false))
+BENCH(b_strCaseAllStr, char **r = strCaseAllStr(s, t); sum += (size_t)r; free(r))
+BENCH(b_strCaseAllStr_, char **r = strCaseAllStr_(s, t); sum += (size_t)r; free(r))
+BENCH(b_strCaseAllStrWith, char **r = strCaseAllStrWith(&_alloc, s, t); sum += (size_t)r; strFreeWith(&_alloc, r))
+BENCH(l_strcasestr_all, sum += _libc_all(s, t, true))
+
+/* Reversal and palindromes */
+BENCH(b_strReverse, sum += (size_t)strReverse(d))
+BENCH(b_strReverse_, strReverse_(d); sum += (size_t)*d)
+BENCH(b_strnReverse, sum += (size_t)strnReverse(d, s, n))
+BENCH(b_strIsPal, sum += strIsPal(s))
+BENCH(b_strIsPal_, sum += strIsPal_(s))
+BENCH(b_strCaseIsPal, sum += strCaseIsPal(s))
+BENCH(b_strCaseIsPal_, sum += strCaseIsPal_(s))
+
+/* Insertion and splicing (each run starts from a fresh copy of the input) */
+BENCH(b_strInsert, memcpy(d, s, n + 1); sum += (size_t)strInsert(d, "<fragment>", n / 2))
+BENCH(b_strInsert_, memcpy(d, s, n + 1); sum += (size_t)strInsert_(d, "<fragment>", n / 2))
+BENCH(b_strnInsert, memcpy(d, s, n + 1); sum += (size_t)strnInsert(d, 2 * n + 64, "<fragment>", n / 2))
+BENCH(b_strSplice, memcpy(d, s, n + 1); sum += (size_t)strSplice(d, 2 * n + 64, n / 4, n / 4, "<fragment>"))
+BENCH(l_memmove_insert, memcpy(d, s, n + 1); sum += (size_t)_libc_insert(d, n, "<fragment>", n / 2))
+static const StrFragment _frags[3] = { { "<a>", 0 }, { "<b>", 0 }, { "<c>", 0 } };
+BENCH(b_strInsertAll, StrFragment f[3] = { _frags[0], _frags[1], _frags[2] }; f[1].idx = n / 2, f[2].idx = n;
+      memcpy(d, s, n + 1); sum += (size_t)strInsertAll(d, 2 * n + 64, f, 3))
+BENCH(l_memmove_insert3, memcpy(d, s, n + 1); _libc_insert(d, n, "<c>", n); _libc_insert(d, n + 3, "<b>", n / 2);
+      sum += (size_t)_libc_insert(d, n + 6, "<a>", 0))
+
+/* Replacement */
+static const StrReplacement _table[2] = { { "zq", "!" }, { "ZQ", "!" } };
+BENCH(b_strReplaceAll, size_t c; char *r = strReplaceAll(s, t, "#", &c); sum += c; free(r))
+BENCH(b_strReplaceAllWith, size_t c; char *r = strReplaceAllWith(&_alloc, s, t, "#", &c); sum += c; strFreeWith(&_alloc, r))
+BENCH(l_strstr_replace, sum += _libc_replace(s, t, "#", false))
+BENCH(b_strCaseReplaceAll, size_t c; char *r = strCaseReplaceAll(s, t, "#", &c); sum += c; free(r))
+BENCH(b_strCaseReplaceAllWith, size_t c; char *r = strCaseReplaceAllWith(&_alloc, s, t, "#", &c); sum += c;
+      strFreeWith(&_alloc, r))
+BENCH(l_strcasestr_replace, sum += _libc_replace(s, t, "#", true))
+BENCH(b_strReplaceAllInPlace, size_t c; memcpy(d, s, n + 1); strReplaceAllInPlace(d, t, "#", &c); sum += c)
+BENCH(l_strstr_replace_in_place, memcpy(d, s, n + 1); sum += _libc_replace_in_place(d, t, "#"))
+BENCH(b_strReplaceTable, size_t c; char *r = strReplaceTable(s, _table, 2, &c); sum += c; free(r))
+BENCH(b_strReplaceTableWith, size_t c; char *r = strReplaceTableWith(&_alloc, s, _table, 2, &c); sum += c;
+      strFreeWith(&_alloc, r))
+
+/* Histograms, permutation checks, sorting and duplicates */
+BENCH(b_strHistogram, size_t counts[EXTENDED_ASCII_RANGE]; sum += strHistogram(s, counts) + counts['a'])
+BENCH(b_strCaseHistogram, size_t counts[EXTENDED_ASCII_RANGE]; sum += strCaseHistogram(s, counts) + counts['a'])
+BENCH(b_strIsPerm, sum += strIsPerm(s, t))
+BENCH(b_strCaseIsPerm, sum += strCaseIsPerm(s, t))
+BENCH(b_strSort, memcpy(d, s, n + 1); sum += strSort(d))
+BENCH(b_strCountSort, memcpy(d, s, n + 1); sum += (size_t)strCountSort(d))
+BENCH(l_qsort, memcpy(d, s, n + 1); qsort(d, n, 1, _cmp_uchar); sum += (size_t)*d)
+BENCH(b_strHasDups, sum += strHasDups(s))
+BENCH(b_strCaseHasDups, sum += strCaseHasDups(s))
+BENCH(b_strnHasDups, sum += strnHasDups(s, n))
+BENCH(b_strnCaseHasDups, sum += strnCaseHasDups(s, n))
+static size_t b_strHasDupsAll(const _Set *set) { return strHasDupsAll(set->strs, set->count, set->flags); }
+static size_t b_strCaseHasDupsAll(const _Set *set) { return strCaseHasDupsAll(set->strs, set->count, set->flags); }
+BENCH(b_strCharCounts, sum += strCharCounts(s, _devnull))
+
+/* Permutations */
+BENCH(b_strPermCount, sum += strPermCount(s, NULL))
+BENCH(b_strPermCountLog10, sum += (size_t)strPermCountLog10(s))
+BENCH(b_strPermRank, sum += strPermRank(s, NULL))
+BENCH(b_strPermUnrank, sum += strPermUnrank(d, 0))
+BENCH(b_strPermShuffle, sum += (size_t)strPermShuffle(d))
+static size_t b_strPermutateAll(const _Set *set) {
+    char str[] = "abcdefgh";                                       // 8! permutations of 9 bytes each (newline included)
+    (void)set;
+    return strPermutateAll(str, _devnull);
+}
+static size_t b_strPermutateAllParallel(const _Set *set) {
+    char str[] = "abcdefgh";
+    (void)set;
+    return strPermutateAllParallel(str, _devnull, 0, true);
+}
+
+/* Hashing (KEY benchmarks: every string of the set has the same length) */
+static uint64_t _fnv1a(const char *s, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)s[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+static uint64_t _stream(const char *s, size_t n, size_t chunk) {
+    StrHashState state;
+    strHashInit(&state, 1, false);
+    for (size_t at = 0; at < n; at += chunk) strHashUpdate(&state, s + at, n - at < chunk ? n - at : chunk);
+    return strHashFinal(&state);
+}
+
+BENCH(b_strHash, sum += strHash(s, 1))
+BENCH(b_strHash_, sum += strHash_(s))
+BENCH(b_strHashN, sum += strHashN(s, n, 1))
+BENCH(b_strCaseHash, sum += strCaseHash(s, 1))
+BENCH(b_strCaseHash_, sum += strCaseHash_(s))
+BENCH(b_strCaseHashN, sum += strCaseHashN(s, n, 1))
+BENCH(b_strHashUpdate, sum += _stream(s, n, n ? n : 1))
+BENCH(b_strHashUpdate7, sum += _stream(s, n, 7))
+BENCH(l_fnv1a, sum += _fnv1a(s, n))
+BENCH(l_fnv1a_strlen, sum += _fnv1a(s, strlen(s)))
+
+static const _Bench _benches[] = {
+    { "strUpr", SCAN, 0, b_strUpr, "toupper loop", l_toupper },
+    { "strLwr", SCAN, 0, b_strLwr, "tolower loop", l_tolower },
+    { "strnUpr", SCAN, 0, b_strnUpr, "toupper loop", l_toupper },
+    { "strnLwr", SCAN, 0, b_strnLwr, "tolower loop", l_tolower },
+    { "strUprAll", SCAN, 0, b_strUprAll, "toupper loop", l_toupper },
+    { "strLwrAll", SCAN, 0, b_strLwrAll, "tolower loop", l_tolower },
+    { "strLen", SCAN, 0, b_strLen, "strlen", l_strlen },
+    { "strLen_", SCAN, 0, b_strLen_, "strlen", l_strlen },
+    { "strCmp", PAIR, 0, b_strCmp, "strcmp", l_strcmp },
+    { "strCmp_", PAIR, 0, b_strCmp_, "strcmp", l_strcmp },
+    { "strCaseCmp", PAIR, 0, b_strCaseCmp, "strcasecmp", l_strcasecmp },
+    { "strCaseCmp_", PAIR, 0, b_strCaseCmp_, "strcasecmp", l_strcasecmp },
+    { "strnCmp", PAIR, 0, b_strnCmp, "strncmp", l_strncmp },
+    { "strnCmp_", PAIR, 0, b_strnCmp_, "strncmp", l_strncmp },
+    { "strnCaseCmp", PAIR, 0, b_strnCaseCmp, "strncasecmp", l_strncasecmp },
+    { "strnCaseCmp_", PAIR, 0, b_strnCaseCmp_, "strncasecmp", l_strncasecmp },
+    { "strCpy", SCAN, 0, b_strCpy, "strcpy", l_strcpy },
+    { "strCaseCpy", SCAN, 0, b_strCaseCpy, "tolower loop", l_strcpy_lower },
+    { "strnCpy", SCAN, 0, b_strnCpy, "strncpy", l_strncpy },
+    { "strnCaseCpy", SCAN, 0, b_strnCaseCpy, "tolower loop", l_strncpy_lower },
+    { "strCat", SCAN, 0, b_strCat, "strcat", l_strcat },
+    { "strCaseCat", SCAN, 0, b_strCaseCat, "tolower loop", l_strcat_lower },
+    { "strCharCat", SCAN, 0, b_strCharCat, "strlen + store", l_strlen_store },
+    { "strCaseCharCat", SCAN, 0, b_strCaseCharCat, "strlen + store", l_strlen_store },
+    { "strMove", SCAN, 0, b_strMove, "memmove", l_memmove },
+    { "strCaseMove", SCAN, 0, b_strCaseMove, "memmove", l_memmove },
+    { "strChr", SEARCH, 0, b_strChr, "strchr", l_strchr },
+    { "strChr_", SEARCH, 0, b_strChr_, "strchr", l_strchr },
+    { "strCaseChr", SEARCH, 0, b_strCaseChr, "strpbrk", l_strpbrk },
+    { "strCaseChr_", SEARCH, 0, b_strCaseChr_, "strpbrk", l_strpbrk },
+    { "strStr", SEARCH, 0, b_strStr, "strstr", l_strstr },
+    { "strStr_", SEARCH, 0, b_strStr_, "strstr", l_strstr },
+    { "strCaseStr", SEARCH, 0, b_strCaseStr, "strcasestr", l_strcasestr },
+    { "strCaseStr_", SEARCH, 0, b_strCaseStr_, "strcasestr", l_strcasestr },
+    { "strAllStr", SEARCH, 0, b_strAllStr, "strstr loop", l_strstr_all },
+    { "strAllStr_", SEARCH, 0, b_strAllStr_, "strstr loop", l_strstr_all },
+    { "strAllStrWith", SEARCH, 0, b_strAllStrWith, "strstr loop", l_strstr_all },
+    { "strCaseAllStr", SEARCH, 0, b_strCaseAllStr, "strcasestr loop", l_strcasestr_all },
+    { "strCaseAllStr_", SEARCH, 0, b_strCaseAllStr_, "strcasestr loop", l_strcasestr_all },
+    { "strCaseAllStrWith", SEARCH, 0, b_strCaseAllStrWith, "strcasestr loop", l_strcasestr_all },
+    { "strReverse", SCAN, 0, b_strReverse, NULL, NULL },
+    { "strReverse_", SCAN, 0, b_strReverse_, NULL, NULL },
+    { "strnReverse", SCAN, 0, b_strnReverse, NULL, NULL },
+    { "strIsPal", PAL, 0, b_strIsPal, NULL, NULL },
+    { "strIsPal_", PAL, 0, b_strIsPal_, NULL, NULL },
+    { "strCaseIsPal", PAL, 0, b_strCaseIsPal, NULL, NULL },
+    { "strCaseIsPal_", PAL, 0, b_strCaseIsPal_, NULL, NULL },
+    { "strInsert", SCAN, 0, b_strInsert, "memmove", l_memmove_insert },
+    { "strInsert_", SCAN, 0, b_strInsert_, "memmove", l_memmove_insert },
+    { "strnInsert", SCAN, 0, b_strnInsert, "memmove", l_memmove_insert },
+    { "strSplice", SCAN, 0, b_strSplice, "memmove", l_memmove_insert },
+    { "strInsertAll", SCAN, 0, b_strInsertAll, "3 x memmove", l_memmove_insert3 },
+    { "strReplaceAll", SEARCH, 0, b_strReplaceAll, "strstr loop", l_strstr_replace },
+    { "strReplaceAllWith", SEARCH, 0, b_strReplaceAllWith, "strstr loop", l_strstr_replace },
+    { "strCaseReplaceAll", SEARCH, 0, b_strCaseReplaceAll, "strcasestr loop", l_strcasestr_replace },
+    { "strCaseReplaceAllWith", SEARCH, 0, b_strCaseReplaceAllWith, "strcasestr loop", l_strcasestr_replace },
+    { "strReplaceAllInPlace", SEARCH, 0, b_strReplaceAllInPlace, "strstr loop", l_strstr_replace_in_place },
+    { "strReplaceTable", SEARCH, 0, b_strReplaceTable, NULL, NULL },
+    { "strReplaceTableWith", SEARCH, 0, b_strReplaceTableWith, NULL, NULL },
+    { "strHistogram", SCAN, 0, b_strHistogram, NULL, NULL },
+    { "strCaseHistogram", SCAN, 0, b_strCaseHistogram, NULL, NULL },
+    { "strIsPerm", PAIR, 0, b_strIsPerm, NULL, NULL },
+    { "strCaseIsPerm", PAIR, 0, b_strCaseIsPerm, NULL, NULL },
+    { "strSort", SCAN, 0, b_strSort, "qsort", l_qsort },
+    { "strCountSort", SCAN, 0, b_strCountSort, "qsort", l_qsort },
+    { "strHasDups", SCAN, 0, b_strHasDups, NULL, NULL },
+    { "strCaseHasDups", SCAN, 0, b_strCaseHasDups, NULL, NULL },
+    { "strnHasDups", SCAN, 0, b_strnHasDups, NULL, NULL },
+    { "strnCaseHasDups", SCAN, 0, b_strnCaseHasDups, NULL, NULL },
+    { "strHasDupsAll", SCAN, 0, b_strHasDupsAll, NULL, NULL },
+    { "strCaseHasDupsAll", SCAN, 0, b_strCaseHasDupsAll, NULL, NULL },
+    { "strCharCounts", SCAN, 0, b_strCharCounts, NULL, NULL },
+    { "strPermCount", SCAN, 4096, b_strPermCount, NULL, NULL },
+    { "strPermCountLog10", SCAN, 0, b_strPermCountLog10, NULL, NULL },
+    { "strPermRank", SCAN, 4096, b_strPermRank, NULL, NULL },
+    { "strPermUnrank", SCAN, 4096, b_strPermUnrank, NULL, NULL },
+    { "strPermShuffle", SCAN, 0, b_strPermShuffle, NULL, NULL },
+    { "strPermutateAll", PERM, 0, b_strPermutateAll, NULL, NULL },
+    { "strPermutateAllParallel", PERM, 0, b_strPermutateAllParallel, NULL, NULL },
+    { "strHash", KEY, 0, b_strHash, "fnv1a + strlen", l_fnv1a_strlen },
+    { "strHash_", KEY, 0, b_strHash_, "fnv1a + strlen", l_fnv1a_strlen },
+    { "strHashN", KEY, 0, b_strHashN, "fnv1a loop", l_fnv1a },
+    { "strCaseHash", KEY, 0, b_strCaseHash, "fnv1a + strlen", l_fnv1a_strlen },
+    { "strCaseHash_", KEY, 0, b_strCaseHash_, "fnv1a + strlen", l_fnv1a_strlen },
+    { "strCaseHashN", KEY, 0, b_strCaseHashN, "fnv1a loop", l_fnv1a },
+    { "strHashUpdate", KEY, 0, b_strHashUpdate, "fnv1a loop", l_fnv1a },
+    { "strHashUpdate/7", KEY, 0, b_strHashUpdate7, "fnv1a loop", l_fnv1a },
+};
+
+/* =========================================================================================================================
+ * _time - Best time of three runs of fn over set, each run repeating fn for at least RUN_SECONDS
+ * ========================================================================================================================*/
+
+static volatile size_t _sink;
+
+static double _time(_BenchFn fn, const _Set *set) {
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+        size_t passes = 0;
+        double start = _now(), elapsed;
+        do _sink += fn(set), ++passes; while ((elapsed = _now() - start) < RUN_SECONDS);
+        if (elapsed / (double)passes < best) best = elapsed / (double)passes;
+    }
+    return best;
+}
+
+/* =========================================================================================================================
+ * _report - Prints one row: time per unit (units = bytes for ns/byte, the number of keys for ns/key) and GB/s, for ours
+ * and for the libc equivalent if there is one
+ * ========================================================================================================================*/
+
+static void _report(const _Bench *b, const char *dist, size_t align, const char *hits, const _Set *set, size_t bytes,
+                    size_t units) {
+    double ours = _time(b->ours, set);
+    printf("%-24s %-7s %5zu %5s %9.3f %8.2f", b->name, dist, align, hits, ours * 1e9 / (double)units, (double)bytes / ours / 1e9);
+    if (b->libc) {
+        double libc = _time(b->libc, set);
+        printf("   %-16s %9.3f %8.2f %7.2fx", b->libc_name, libc * 1e9 / (double)units, (double)bytes / libc / 1e9, libc / ours);
+    }
+    putchar('\n');
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : "";
+    _devnull = fopen("/dev/null", "w");
+    srand(1);
+
+    int header = -1;                                                // Table the last header was printed for: 0 ns/byte, 1 ns/key
+    for (size_t k = 0; k < sizeof(_benches) / sizeof(*_benches); ++k) {
+        const _Bench *b = &_benches[k];
+        if (!strstr(b->name, filter)) continue;
+        if (header != (b->kind == KEY)) {
+            const char *unit = b->kind == KEY ? "ns/key" : "ns/byte";
+            printf("%s%-24s %-7s %5s %5s %9s %8s   %-16s %9s %8s %8s\n", header < 0 ? "" : "\n", "function",
+                   b->kind == KEY ? "key" : "lengths", "align", "hits", unit, "GB/s", "libc", unit, "GB/s", "speedup");
+            header = b->kind == KEY;
+        }
+        if (b->kind == PERM) {
+            _Set set = { 0 };
+            _report(b, "8!", 0, "-", &set, 40320 * 9, 40320 * 9);
+            continue;
+        }
+        if (b->kind == KEY) {
+            for (size_t li = 0; li < sizeof(_key_lens) / sizeof(*_key_lens); ++li) {
+                for (size_t ai = 0; ai < sizeof(_aligns) / sizeof(*_aligns); ++ai) {
+                    char key[8];
+                    snprintf(key, sizeof(key), _key_lens[li] < 1024 ? "%zu" : "%zuK", _key_lens[li] < 1024 ? _key_lens[li] : _key_lens[li] / 1024);
+                    _Set set;
+                    _set_create(&set, KEY, _key_lens[li], _key_lens[li], _aligns[ai], 0);
+                    _report(b, key, _aligns[ai], "-", &set, set.bytes, set.count);
+                    _set_free(&set);
+                }
+            }
+            continue;
+        }
+        for (size_t di = 0; di < sizeof(_dists) / sizeof(*_dists); ++di) {
+            if (b->max_len && _dists[di].hi > b->max_len) continue;
+            for (size_t ai = 0; ai < sizeof(_aligns) / sizeof(*_aligns); ++ai) {
+                for (size_t hi = 0; hi < sizeof(_hit_percents) / sizeof(*_hit_percents); ++hi) {
+                    if (b->kind == SCAN && hi) break;              // Hit ratio only matters for searches & comparisons
+                    char hits[8] = "-";
+                    if (b->kind != SCAN) snprintf(hits, sizeof(hits), "%d%%", _hit_percents[hi]);
+                    _Set set;
+                    _set_create(&set, b->kind, _dists[di].lo, _dists[di].hi, _aligns[ai], _hit_percents[hi]);
+                    _report(b, _dists[di].name, _aligns[ai], hits, &set, set.bytes, set.bytes);
+                    _set_free(&set);
+                }
+            }
+        }
+    }
+    fclose(_devnull);
+    return (int)(_sink & 0);
+}
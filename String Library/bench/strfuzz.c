@@ -0,0 +1,998 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strfuzz.c                                                                                                               *
+ *                                                                                                                         *
+ * Differential fuzzer for strings.h, strhash.h, strbatch.h, strfuzzy.h, stranagram.h, strbuilder.h, strpattern.h and      *
+ * strintern.h. Random strings (several alphabets including bytes >= 0x80, lengths around the SIMD block sizes, unaligned  *
+ * starts, planted matches) go through every public function and the results are compared with glibc, or with a plain      *
+ * reference (byte loops, a full edit distance table, a backtracking glob matcher) where glibc has no equivalent. Strings  *
+ * are also placed so their NUL is the last byte of a page followed by an unmapped one, so a kernel that reads past the    *
+ * terminator faults instead of passing silently. The intern pool is also filled from several threads at once. Prints the  *
+ * first failures and exits with status 1 if there were any.                                                               *
+ *                                                                                                                         *
+ * Build (from this directory):                                                                                            *
+ *     gcc -O2 -g -fsanitize=address,undefined strfuzz.c ../str*.c -lm -pthread -o strfuzz                                 *
+ * Run: ./strfuzz [iterations] [seed]                                                                                      *
+ * ======================================================================================================================= */
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../strings.h"
+#include "../strhash.h"
+#include "../strbatch.h"
+#include "../strfuzzy.h"
+#include "../stranagram.h"
+#include "../strbuilder.h"
+#include "../strpattern.h"
+#include "../strintern.h"
+
+#define MAX_LEN 4200                    // Longest generated string: enough for several 16 and 64 byte blocks plus tails
+
+static unsigned long failures = 0;
+
+/* =========================================================================================================================
+ * _fail - Reports one failure with the inputs that caused it (the first 25 only)
+ * ========================================================================================================================*/
+
+static void _show(const char *label, const char *s) {
+    size_t n = strlen(s);
+    printf("  %s (%zu) \"", label, n);
+    for (size_t i = 0; i < n && i < 80; ++i) {
+        unsigned char c = (unsigned char)s[i];
+        if (isprint(c)) putchar(c);
+        else printf("\\x%02x", c);
+    }
+    printf(n > 80 ? "\"...\n" : "\"\n");
+}
+
+static void _fail(const char *name, const char *a, const char *b, size_t n) {
+    if (failures++ >= 25) return;
+    printf("FAIL %s (n = %zu)\n", name, n);
+    _show("a", a), _show("b", b);
+}
+
+#define CHECK(cond, name) do { if (!(cond)) _fail(name, a, b, n); } while (0)
+
+static int _sign(long v) {
+    return (v > 0) - (v < 0);
+}
+
+/* =========================================================================================================================
+ * Generators - Random lengths biased towards block boundaries, random alphabets, and needles planted in haystacks
+ * ========================================================================================================================*/
+
+static const char *_alphabets[] = { "ab", "aAbB", "abcxyz", "aAbBzZ\xe9\xc9\x80\xff", "a", NULL };
+
+static size_t _rand_len(void) {
+    switch (rand() % 8) {
+        case 0:  return (size_t)(rand() % 4);
+        case 1:  return (size_t)(16 * (1 + rand() % 4) + rand() % 3 - 1);       // Around a 16 byte block boundary
+        case 2:  return (size_t)(rand() % 300);
+        case 3:  return (size_t)(rand() % MAX_LEN);
+        default: return (size_t)(rand() % 40);
+    }
+}
+
+static void _rand_str(char *s, size_t len, const char *alpha) {
+    size_t k = alpha ? strlen(alpha) : 0;
+    for (size_t i = 0; i < len; ++i) s[i] = alpha ? alpha[rand() % k] : (char)(1 + rand() % 255);
+    s[len] = '\0';
+}
+
+static void _plant(char *a, const char *b, bool change_case) {
+    size_t la = strlen(a), lb = strlen(b);
+    if (lb > la) return;
+    char *p = a + rand() % (la - lb + 1);
+    memcpy(p, b, lb);
+    if (change_case) for (size_t i = 0; i < lb; ++i) if (rand() % 2) p[i] = (char)toupper((unsigned char)p[i]);
+}
+
+/* =========================================================================================================================
+ * _page_end - Copies s so that its NUL is the last byte before an unmapped page
+ * ========================================================================================================================*/
+
+static char *_guard = NULL;
+static size_t _page = 0;
+
+static char *_page_end(const char *s) {
+    size_t n = strlen(s) + 1;
+    if (n > _page) return NULL;
+    return memcpy(_guard + _page - n, s, n);
+}
+
+/* =========================================================================================================================
+ * Reference implementations for functions glibc doesn't have
+ * ========================================================================================================================*/
+
+static void _ref_fold(char *d, const char *s, size_t n, bool upper) {
+    for (size_t i = 0; i < n; ++i) d[i] = (char)(upper ? toupper((unsigned char)s[i]) : tolower((unsigned char)s[i]));
+}
+
+static const char *_ref_casechr(const char *s, unsigned char c) {
+    for (c = (unsigned char)tolower(c);; ++s) {
+        if ((unsigned char)tolower((unsigned char)*s) == c) return s;
+        if (!*s) return NULL;
+    }
+}
+
+static bool _ref_pal(const char *s, bool fold) {
+    for (size_t i = 0, j = strlen(s); i + 1 < j; ++i, --j) {
+        unsigned char x = (unsigned char)s[i], y = (unsigned char)s[j-1];
+        if (fold ? tolower(x) != tolower(y) : x != y) return false;
+    }
+    return true;
+}
+
+static char *_ref_replace(const char *s, const char *needle, const char *rep, bool fold, size_t *count) {
+    size_t m = strlen(needle), r = strlen(rep), out = 0;
+    char *res = malloc(strlen(s) * (r + 1) + 1);
+    *count = 0;
+    while (*s) {
+        if (m && (fold ? !strncasecmp(s, needle, m) : !strncmp(s, needle, m))) {
+            memcpy(res + out, rep, r), out += r, s += m, ++*count;
+        } else res[out++] = *s++;
+    }
+    res[out] = '\0';
+    return res;
+}
+
+static char *_ref_table(const char *s, const StrReplacement *t, size_t n, size_t *count) {
+    size_t longest = 0;
+    for (size_t k = 0; k < n; ++k) longest = strlen(t[k].rep) > longest ? strlen(t[k].rep) : longest;
+    char *res = malloc(strlen(s) * (longest + 1) + 1);
+    size_t out = 0;
+    *count = 0;
+    while (*s) {
+        size_t k = 0;
+        for (; k < n; ++k) if (*t[k].needle && !strncmp(s, t[k].needle, strlen(t[k].needle))) break;
+        if (k < n) {
+            strcpy(res + out, t[k].rep), out += strlen(t[k].rep), s += strlen(t[k].needle), ++*count;
+        } else res[out++] = *s++;
+    }
+    res[out] = '\0';
+    return res;
+}
+
+static int _cmp_uchar(const void *x, const void *y) {
+    return *(const unsigned char *)x - *(const unsigned char *)y;
+}
+
+static int _cmp_handle(const void *x, const void *y) {
+    StrHandle h1 = *(const StrHandle *)x, h2 = *(const StrHandle *)y;
+    return (h1 > h2) - (h1 < h2);
+}
+
+static bool _ref_dups(const char *s, bool fold) {
+    bool seen[EXTENDED_ASCII_RANGE] = {false};
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)(fold ? tolower((unsigned char)*s) : *s);
+        if (seen[c]) return true;
+        seen[c] = true;
+    }
+    return false;
+}
+
+/* Lexicographic next permutation by unsigned char value. Returns false after the last one */
+static bool _ref_next_perm(unsigned char *s, size_t n) {
+    if (n < 2) return false;
+    size_t i = n - 1;
+    while (i && s[i-1] >= s[i]) --i;
+    if (!i) return false;
+    size_t j = n - 1;
+    while (s[j] <= s[i-1]) --j;
+    unsigned char t = s[i-1]; s[i-1] = s[j], s[j] = t;
+    for (size_t l = i, r = n - 1; l < r; ++l, --r) t = s[l], s[l] = s[r], s[r] = t;
+    return true;
+}
+
+/* =========================================================================================================================
+ * _fuzz_one - One round: builds a haystack a and a needle b, then checks every function against its reference
+ * ========================================================================================================================*/
+
+static char abuf[MAX_LEN + 64], bbuf[MAX_LEN + 64], d1[4 * MAX_LEN + 64], d2[4 * MAX_LEN + 64];
+
+static void _fuzz_one(void) {
+    const char *alpha = _alphabets[rand() % (sizeof(_alphabets) / sizeof(*_alphabets))];
+    char *a = abuf + rand() % 16, *b = bbuf + rand() % 16;         // Unaligned starts
+    size_t la = _rand_len(), lb = rand() % 4 ? (size_t)(rand() % 6) : _rand_len() % 40, n = (size_t)(rand() % 50);
+    _rand_str(a, la, alpha), _rand_str(b, lb, alpha);
+    if (rand() % 3 == 0) _plant(a, b, rand() % 2);
+    if (rand() % 4 == 0 && lb <= la) memcpy(a, b, lb);             // Shared prefix, so comparisons run deeper
+    if (rand() % 8 == 0) memcpy(b, a, lb <= la ? lb : la + 1);      // b a prefix of a (or equal to it)
+    lb = strlen(b);
+    unsigned char ch = (unsigned char)(lb ? b[0] : rand() % 4 ? 'a' : 0);
+    bool ascii = alpha != NULL;
+
+    // Length, comparison and search (also with the string ending right before an unmapped page)
+    CHECK(strLen(a) == la, "strLen");
+    { char *x = a; CHECK((size_t)strLen_(x) == la, "strLen_"); }
+    CHECK(_sign(strCmp(a, b)) == _sign(strcmp(a, b)), "strCmp");
+    CHECK(_sign(strCmp_(a, b)) == _sign(strcmp(a, b)), "strCmp_");
+    CHECK(_sign(strnCmp(a, b, (long)n)) == _sign(strncmp(a, b, n)), "strnCmp");
+    CHECK(_sign(strnCmp_(a, b, (long)n)) == _sign(strncmp(a, b, n)), "strnCmp_");
+    if (ascii) {
+        CHECK(_sign(strCaseCmp(a, b)) == _sign(strcasecmp(a, b)), "strCaseCmp");
+        CHECK(_sign(strCaseCmp_(a, b)) == _sign(strcasecmp(a, b)), "strCaseCmp_");
+        CHECK(_sign(strnCaseCmp(a, b, (long)n)) == _sign(strncasecmp(a, b, n)), "strnCaseCmp");
+        CHECK(_sign(strnCaseCmp_(a, b, (long)n)) == _sign(strncasecmp(a, b, n)), "strnCaseCmp_");
+    }
+    CHECK(strChr(a, ch) == strchr(a, ch), "strChr");
+    { char *x = a; CHECK(strChr_(x, ch) == strchr(a, ch), "strChr_"); }
+    CHECK(strCaseChr(a, ch) == _ref_casechr(a, ch), "strCaseChr");
+    { char *x = a; CHECK(strCaseChr_(x, ch) == _ref_casechr(a, ch), "strCaseChr_"); }
+    CHECK(strStr(a, b) == strstr(a, b), "strStr");
+    { char *x = a, *y = b; CHECK(strStr_(x, y) == strstr(a, b), "strStr_"); }
+    if (ascii) {
+        CHECK(strCaseStr(a, b) == strcasestr(a, b), "strCaseStr");
+        char *x = a, *y = b; CHECK(strCaseStr_(x, y) == strcasestr(a, b), "strCaseStr_");
+    }
+    char *g = _page_end(a);
+    if (g) {
+        CHECK(strLen(g) == la, "strLen (page end)");
+        CHECK(_sign(strCmp(g, b)) == _sign(strcmp(a, b)), "strCmp (page end)");
+        CHECK(_sign(strCaseCmp(g, b)) == _sign(strcasecmp(a, b)), "strCaseCmp (page end)");
+        CHECK(strChr(g, ch) == (strchr(a, ch) ? g + (strchr(a, ch) - a) : NULL), "strChr (page end)");
+        CHECK(strCaseChr(g, ch) == (_ref_casechr(a, ch) ? g + (_ref_casechr(a, ch) - a) : NULL), "strCaseChr (page end)");
+        CHECK(strStr(g, b) == (strstr(a, b) ? g + (strstr(a, b) - a) : NULL), "strStr (page end)");
+        CHECK(strIsPal(g) == _ref_pal(a, false), "strIsPal (page end)");
+        CHECK(strCaseCpy(d1, g) == (ptrdiff_t)la, "strCaseCpy (page end)");
+    }
+
+    // All matches
+    if (lb) {
+        char **r1 = strAllStr(a, b), **r2 = NULL, **r3 = NULL;
+        { char *x = a, *y = b; r2 = strAllStr_(x, y); }
+        size_t k = 0;
+        for (char *p = a; (p = strstr(p, b)); p += lb, ++k) if (!r1 || r1[k] != p || !r2 || r2[k] != p) break;
+        CHECK(r1 && r2 && !r1[k] && !r2[k], "strAllStr");
+        free(r1), free(r2);
+        if (ascii) {
+            StrAllocator alloc = STRALLOCATOR_DEFAULT;
+            r1 = strCaseAllStr(a, b), r3 = strCaseAllStrWith(&alloc, a, b);
+            { char *x = a, *y = b; r2 = strCaseAllStr_(x, y); }
+            k = 0;
+            for (char *p = a; (p = strcasestr(p, b)); p += lb, ++k) {
+                if (!r1 || r1[k] != p || !r2 || r2[k] != p || !r3 || r3[k] != p) break;
+            }
+            CHECK(r1 && r2 && r3 && !r1[k] && !r2[k] && !r3[k], "strCaseAllStr");
+            free(r1), free(r2), strFreeWith(&alloc, r3);
+        }
+    }
+
+    // Copies, concatenation and moves
+    memset(d1, 'x', la + 32), memset(d2, 'x', la + 32);
+    CHECK(strCpy(d1, a) == (ptrdiff_t)la && !strcmp(d1, a), "strCpy");
+    memset(d1, 'x', la + 32);
+    _ref_fold(d2, a, la + 1, false);
+    CHECK(strCaseCpy(d1, a) == (ptrdiff_t)la && !memcmp(d1, d2, la + 1), "strCaseCpy");
+    size_t m = n <= la ? n : la;
+    memset(d1, 'x', m + 32), memset(d2, 'x', m + 32);
+    CHECK(strnCpy(d1, a, m) == (ptrdiff_t)m && !memcmp(d1, a, m) && d1[m] == 'x', "strnCpy");
+    _ref_fold(d2, a, m, false);
+    CHECK(strnCaseCpy(d1, a, m) == (ptrdiff_t)m && !memcmp(d1, d2, m) && d1[m] == 'x', "strnCaseCpy");
+    strcpy(d1, b), strcpy(d2, b), strcat(d2, a);
+    CHECK(strCat(d1, a) == (ptrdiff_t)la && !strcmp(d1, d2), "strCat");
+    strcpy(d1, b), strcpy(d2, b), _ref_fold(d2 + lb, a, la + 1, false);
+    CHECK(strCaseCat(d1, a) == (ptrdiff_t)la && !strcmp(d1, d2), "strCaseCat");
+    if (ch) {
+        strcpy(d1, a), strcpy(d2, a), d2[la] = (char)ch, d2[la + 1] = '\0';
+        CHECK(strCharCat(d1, (char)ch) == d1 && !strcmp(d1, d2), "strCharCat");
+        strcpy(d1, a), d2[la] = (char)tolower(ch);
+        CHECK(strCaseCharCat(d1, (char)ch) == d1 && !strcmp(d1, d2), "strCaseCharCat");
+        memset(d1, 'x', la + 8), strcpy(d1, a);
+        { char *x = d1; CHECK(strCaseCharCat_(x, (char)ch) == d1 && !strcmp(d1, d2), "strCaseCharCat_"); }
+        memset(d1, 'x', la + 8), strcpy(d1, a), d2[la] = (char)ch;
+        { char *x = d1; CHECK(strCharCat_(x, (char)ch) == d1 && !strcmp(d1, d2), "strCharCat_"); }
+    }
+    size_t off = (size_t)(rand() % 9), len = la / 2 + 1;
+    memset(d1, 'x', la + off + 1), memset(d2, 'x', la + off + 1);
+    memcpy(d1, a, la + 1), memcpy(d2, a, la + 1);
+    memmove(d2 + off, d2, len);
+    CHECK(strMove(d1 + off, d1, len) == d1 + off && !memcmp(d1, d2, la + off + 1), "strMove");
+    memset(d1, 'x', la + off + 1), memcpy(d1, a, la + 1);
+    _ref_fold(d2 + off, d2 + off, len, false);
+    CHECK(strCaseMove(d1 + off, d1, len) == d1 + off && !memcmp(d1, d2, la + off + 1), "strCaseMove");
+    CHECK(strMove(d1, d1, 0) == NULL, "strMove (n = 0)");
+
+    // Case conversion
+    strcpy(d1, a), _ref_fold(d2, a, la + 1, true);
+    CHECK(strUpr(d1) == (la ? d1 : NULL) && !strcmp(d1, d2), "strUpr");                // NULL for an empty string
+    strcpy(d1, a), _ref_fold(d2, a, la + 1, false);
+    CHECK(strLwr(d1) == (la ? d1 : NULL) && !strcmp(d1, d2), "strLwr");                // NULL for an empty string
+    memcpy(d1, a, la + 1), memcpy(d2, a, la + 1), _ref_fold(d2, a, m, true);
+    CHECK(strnUpr(d1, m) == d1 && !memcmp(d1, d2, la + 1), "strnUpr");
+    memcpy(d1, a, la + 1), memcpy(d2, a, la + 1), _ref_fold(d2, a, m, false);
+    CHECK(strnLwr(d1, m) == d1 && !memcmp(d1, d2, la + 1), "strnLwr");
+    {
+        char *strs[3] = { d1, NULL, d1 + la + 1 };
+        strcpy(d1, a), strcpy(d1 + la + 1, b);
+        _ref_fold(d2, a, la + 1, true), _ref_fold(d2 + la + 1, b, lb + 1, true);
+        CHECK(strUprAll(strs, 3) == 2 && !memcmp(d1, d2, la + lb + 2), "strUprAll");
+        _ref_fold(d2, a, la + 1, false), _ref_fold(d2 + la + 1, b, lb + 1, false);
+        CHECK(strLwrAll(strs, 3) == 2 && !memcmp(d1, d2, la + lb + 2), "strLwrAll");
+    }
+
+    // Reversal and palindromes (half the time on a planted palindrome)
+    strcpy(d1, a);
+    for (size_t i = 0; i < la; ++i) d2[i] = a[la - 1 - i];
+    d2[la] = '\0';
+    CHECK(strReverse(d1) == d1 && !strcmp(d1, d2), "strReverse");
+    { strcpy(d1, a); char *x = d1; strReverse_(x); CHECK(!strcmp(d1, d2), "strReverse_"); }
+    memset(d1, 'x', m + 1);
+    CHECK(strnReverse(d1, a, m) == d1 && !memcmp(d1, d2 + la - m, m), "strnReverse");
+    memset(d1, 'x', m + 1);
+    { char *x = d1; strnReverse_(x, a, m); CHECK(!memcmp(d1, d2 + la - m, m) && d1[m] == 'x', "strnReverse_"); }
+    if (rand() % 2) for (size_t i = 0; i < la / 2; ++i) a[la - 1 - i] = rand() % 4 ? a[i] : (char)toupper((unsigned char)a[i]);
+    CHECK(strIsPal(a) == _ref_pal(a, false), "strIsPal");
+    CHECK(strCaseIsPal(a) == _ref_pal(a, true), "strCaseIsPal");
+    { char *x = a; CHECK(strIsPal_(x) == _ref_pal(a, false), "strIsPal_"); }
+    if (ascii) { char *x = a; CHECK(strCaseIsPal_(x) == _ref_pal(a, true), "strCaseIsPal_"); }
+
+    // Insertion and splicing
+    size_t idx = (size_t)(rand() % (la + 3)), at = idx < la ? idx : la, del = (size_t)(rand() % 6);
+    del = del < la - at ? del : la - at;
+    memcpy(d2, a, at), memcpy(d2 + at, b, lb), strcpy(d2 + at + lb, a + at);
+    strcpy(d1, a);
+    CHECK(strInsert(d1, b, idx) == d1 && !strcmp(d1, d2), "strInsert");
+    size_t cap = la + lb + 1 - (rand() % 2);                       // Exactly enough room, or one byte short
+    strcpy(d1, a);
+    char *ins = strnInsert(d1, cap, b, idx);
+    CHECK(cap == la + lb + 1 ? ins == d1 && !strcmp(d1, d2) : !ins && !strcmp(d1, a), "strnInsert");
+    memcpy(d2, a, at), memcpy(d2 + at, b, lb), strcpy(d2 + at + lb, a + at + del);
+    strcpy(d1, a);
+    CHECK(strSplice(d1, la + lb + 1, idx, del, b) == d1 && !strcmp(d1, d2), "strSplice");
+    {
+        StrFragment frags[3] = { { b, at / 2 }, { "<>", at }, { b, at } };
+        size_t i1 = at / 2;
+        memcpy(d2, a, i1), strcpy(d2 + i1, b), memcpy(d2 + i1 + lb, a + i1, at - i1);
+        strcpy(d2 + lb + at, "<>"), strcpy(d2 + lb + at + 2, b), strcpy(d2 + 2 * lb + at + 2, a + at);
+        strcpy(d1, a);
+        CHECK(strInsertAll(d1, la + 2 * lb + 3, frags, 3) == d1 && !strcmp(d1, d2), "strInsertAll");
+        strcpy(d1, a);
+        CHECK(!strInsertAll(d1, la + 2 * lb + 2, frags, 3) && !strcmp(d1, a), "strInsertAll (no room)");
+    }
+
+    // Replacement
+    if (lb) {
+        const char *rep = rand() % 2 ? "" : rand() % 2 ? "#" : "<<long replacement>>";
+        size_t c1, c2;
+        char *r1 = strReplaceAll(a, b, rep, &c1), *r2 = _ref_replace(a, b, rep, false, &c2);
+        CHECK(r1 && !strcmp(r1, r2) && c1 == c2, "strReplaceAll");
+        free(r1), free(r2);
+        if (ascii) {
+            r1 = strCaseReplaceAll(a, b, rep, &c1), r2 = _ref_replace(a, b, rep, true, &c2);
+            CHECK(r1 && !strcmp(r1, r2) && c1 == c2, "strCaseReplaceAll");
+            free(r1), free(r2);
+        }
+        strcpy(d1, a);
+        r1 = strReplaceAllInPlace(d1, b, rep, &c1), r2 = _ref_replace(a, b, rep, false, &c2);
+        CHECK(strlen(rep) > lb ? !r1 && !strcmp(d1, a) : r1 == d1 && !strcmp(d1, r2) && c1 == c2, "strReplaceAllInPlace");
+        free(r2);
+        StrReplacement table[3] = { { b, rep }, { "a", "[A]" }, { "", "never" } };
+        r1 = strReplaceTable(a, table, 3, &c1), r2 = _ref_table(a, table, 3, &c2);
+        CHECK(r1 && !strcmp(r1, r2) && c1 == c2, "strReplaceTable");
+        free(r1), free(r2);
+    }
+
+    // Histograms, permutation checks, sorting and duplicates
+    size_t h1[EXTENDED_ASCII_RANGE], h2[EXTENDED_ASCII_RANGE] = {0}, h3[EXTENDED_ASCII_RANGE] = {0};
+    for (const char *p = a; *p; ++p) ++h2[(unsigned char)*p], ++h3[(unsigned char)tolower((unsigned char)*p)];
+    CHECK(strHistogram(a, h1) == la && !memcmp(h1, h2, sizeof(h1)), "strHistogram");
+    CHECK(strCaseHistogram(a, h1) == la && !memcmp(h1, h3, sizeof(h1)), "strCaseHistogram");
+    strcpy(d1, a), strcpy(d2, a);
+    qsort(d2, la, 1, _cmp_uchar);
+    CHECK(strSort(d1) == (la > 0) && !strcmp(d1, d2), "strSort");
+    strcpy(d1, a);
+    CHECK(strCountSort(d1) == d1 && !strcmp(d1, d2), "strCountSort");
+    strcpy(d1, a);
+    for (size_t i = la; i > 1; --i) { size_t j = (size_t)rand() % i; char t = d1[i-1]; d1[i-1] = d1[j], d1[j] = t; }
+    if (rand() % 2 && la) d1[rand() % la] = rand() % 2 ? 'q' : (char)toupper((unsigned char)d1[0]);
+    strcpy(d2, d1), qsort(d2, la, 1, _cmp_uchar);
+    { char s2[MAX_LEN + 1]; strcpy(s2, a), qsort(s2, la, 1, _cmp_uchar); CHECK(strIsPerm(a, d1) == !strcmp(s2, d2), "strIsPerm"); }
+    _ref_fold(d2, d1, la + 1, false), qsort(d2, la, 1, _cmp_uchar);
+    {
+        char s2[MAX_LEN + 1];
+        _ref_fold(s2, a, la + 1, false), qsort(s2, la, 1, _cmp_uchar);
+        CHECK(strCaseIsPerm(a, d1) == !strcmp(s2, d2), "strCaseIsPerm");
+    }
+    CHECK(strHasDups(a) == _ref_dups(a, false), "strHasDups");
+    CHECK(strCaseHasDups(a) == _ref_dups(a, true), "strCaseHasDups");
+    {
+        char p[MAX_LEN + 1];
+        memcpy(p, a, m), p[m] = '\0';
+        CHECK(strnHasDups(a, m) == _ref_dups(p, false), "strnHasDups");
+        CHECK(strnCaseHasDups(a, m) == _ref_dups(p, true), "strnCaseHasDups");
+    }
+    {
+        char *strs[3] = { a, NULL, b };
+        bool res[3];
+        size_t dups = _ref_dups(a, false) + _ref_dups(b, false);
+        CHECK(strHasDupsAll(strs, 3, res) == dups && res[0] == _ref_dups(a, false) && !res[1] && res[2] == _ref_dups(b, false), "strHasDupsAll");
+        dups = _ref_dups(a, true) + _ref_dups(b, true);
+        CHECK(strCaseHasDupsAll(strs, 3, res) == dups && res[0] == _ref_dups(a, true) && !res[1], "strCaseHasDupsAll");
+    }
+}
+
+/* =========================================================================================================================
+ * _fuzz_perms - Permutation functions on short strings, against an explicit enumeration with next permutation
+ * ========================================================================================================================*/
+
+static void _fuzz_perms(void) {
+    static char seq[8 * 5040];                                     // Every permutation of up to 7 characters, one per line
+    char a[10], b[10] = "", *out1, *out2;
+    size_t n = (size_t)(rand() % 8), sz1, sz2;
+    _rand_str(a, n, rand() % 2 ? "aab" : "abcdefgh");
+
+    // Enumerate from the sorted string; the rank of each is its position in the sequence
+    unsigned char s[10];
+    memcpy(s, a, n + 1), qsort(s, n, 1, _cmp_uchar);
+    size_t count = 0, used = 0, rank_a = SIZE_MAX;
+    do {
+        if (!memcmp(s, a, n)) rank_a = count;
+        char u[10];
+        memcpy(u, s, n + 1);
+        CHECK(strPermUnrank(u, count) && !memcmp(u, s, n), "strPermUnrank");
+        memcpy(seq + used, s, n), seq[used + n] = '\n', used += n + 1, ++count;
+    } while (_ref_next_perm(s, n));
+    bool overflow = true;
+    CHECK(strPermCount(a, &overflow) == count && !overflow, "strPermCount");
+    CHECK(fabs(pow(10, strPermCountLog10(a)) - (double)count) < 1e-6 * count + 1e-9, "strPermCountLog10");
+    CHECK(strPermRank(a, NULL) == rank_a, "strPermRank");
+    strcpy(b, a);
+    CHECK(!strPermUnrank(b, count) && !strcmp(a, b), "strPermUnrank (out of range)");
+    strPermShuffle(b);
+    { char x[10], y[10]; strcpy(x, a), strcpy(y, b); qsort(x, n, 1, _cmp_uchar), qsort(y, n, 1, _cmp_uchar); CHECK(!strcmp(x, y), "strPermShuffle"); }
+
+    if (!n) return;                                                // Nothing to enumerate for the empty string
+    FILE *f1 = open_memstream(&out1, &sz1), *f2 = open_memstream(&out2, &sz2);
+    strcpy(b, a);
+    size_t r1 = strPermutateAll(b, f1), r2 = strPermutateAllParallel(a, f2, 1 + (unsigned int)(rand() % 4), true);
+    fclose(f1), fclose(f2);
+    CHECK(r1 == count && sz1 == used && !memcmp(out1, seq, used), "strPermutateAll");
+    CHECK(r2 == count && sz2 == used && !memcmp(out2, seq, used), "strPermutateAllParallel");
+    free(out1), free(out2);
+}
+
+/* =========================================================================================================================
+ * _fuzz_hash - Streaming against one-shot hashing for random splits, case folding against hashing the lowered bytes, and
+ * a regression for seed independent collisions: a word equal to _P1 (or _P3) used to zero its multiply whatever the
+ * seed, so these fixed pairs collided under every seed
+ * ========================================================================================================================*/
+
+static void _fuzz_hash(void) {
+    const uint64_t p1 = 0xe7037ed1a0b428dbULL, p3 = 0x589965cc75374cc3ULL;
+    uint64_t seed = (uint64_t)rand() << 33 ^ (uint64_t)rand() << 11 ^ (uint64_t)rand();
+    char a[80], b[80], lowered[80];
+    size_t n = (size_t)(rand() % 80);
+    for (size_t i = 0; i < n; ++i) a[i] = (char)rand(), lowered[i] = (char)tolower((unsigned char)a[i]);
+    a[n] = '\0', strcpy(b, "(split)");
+
+    StrHashState state;
+    strHashInit(&state, seed, false);
+    for (size_t at = 0, step; at < n; at += step) step = 1 + (size_t)rand() % (n - at), strHashUpdate(&state, a + at, step);
+    CHECK(strHashFinal(&state) == strHashN(a, n, seed), "strHashUpdate");
+    CHECK(strCaseHashN(a, n, seed) == strHashN(lowered, n, seed), "strCaseHashN");
+
+    unsigned char x[32], y[32];
+    memcpy(x, "AAAAAAAA", 8), memcpy(y, "zzzzqqqq", 8), memcpy(x + 8, &p1, 8), memcpy(y + 8, &p1, 8);
+    if (strHashN(x, 16, seed) == strHashN(y, 16, seed)) _fail("strHashN (seed independent collision)", "AAAAAAAA+P1", "zzzzqqqq+P1", 16);
+    memset(x, 'x', 32), memset(y, 'y', 32);
+    memcpy(x + 8, &p1, 8), memcpy(y + 8, &p1, 8), memcpy(x + 24, &p3, 8), memcpy(y + 24, &p3, 8);
+    if (strHashN(x, 32, seed) == strHashN(y, 32, seed)) _fail("strHashN (seed independent collision)", "x*8+P1+x*8+P3", "y*8+P1+y*8+P3", 32);
+}
+
+/* =========================================================================================================================
+ * _fuzz_batch - Batch equality and duplicate checks in both layouts against per-string references. The packed blob is
+ * allocated to its exact size, so the vector compares of the last strings must fall back instead of reading past it
+ * ========================================================================================================================*/
+
+static void _fuzz_batch(void) {
+    enum { COUNT = 67 };
+    char *strs[COUNT], a[24], b[24] = "(batch)";
+    size_t offsets[COUNT + 1] = {0}, n = (size_t)(rand() % 20);
+    bool res[COUNT], ref[COUNT];
+    _rand_str(a, n, "aAbB");
+    for (size_t i = 0; i < COUNT; ++i) {
+        size_t len = rand() % 3 ? n : (size_t)(rand() % 20);
+        strs[i] = malloc(len + 1);
+        _rand_str(strs[i], len, "aAbB");
+        if (len == n && rand() % 2) for (size_t k = 0; k < n; ++k) strs[i][k] = rand() % 2 ? a[k] : (char)(a[k] ^ 0x20);
+        offsets[i+1] = offsets[i] + len;
+    }
+    char *blob = malloc(offsets[COUNT] ? offsets[COUNT] : 1);
+    for (size_t i = 0; i < COUNT; ++i) memcpy(blob + offsets[i], strs[i], offsets[i+1] - offsets[i]);
+    StrBatch array = strBatchArray_(strs, COUNT), packed = strBatchPacked_(blob, offsets, COUNT);
+
+    for (int fold = 0; fold < 2; ++fold) {
+        size_t expect = 0;
+        for (size_t i = 0; i < COUNT; ++i) expect += ref[i] = fold ? !strcasecmp(strs[i], a) : !strcmp(strs[i], a);
+        const char *name = fold ? "strBatchCaseEquals" : "strBatchEquals";
+        for (int layout = 0; layout < 2; ++layout) {
+            const StrBatch *batch = layout ? &packed : &array;
+            size_t found = fold ? strBatchCaseEquals(batch, a, res, 1) : strBatchEquals(batch, a, res, 1);
+            CHECK(found == expect && !memcmp(res, ref, sizeof(res)), name);
+        }
+        expect = 0;
+        for (size_t i = 0; i < COUNT; ++i) expect += ref[i] = _ref_dups(strs[i], fold);
+        name = fold ? "strBatchCaseHasDups" : "strBatchHasDups";
+        for (int layout = 0; layout < 2; ++layout) {
+            const StrBatch *batch = layout ? &packed : &array;
+            size_t found = fold ? strBatchCaseHasDups(batch, res, 1) : strBatchHasDups(batch, res, 1);
+            CHECK(found == expect && !memcmp(res, ref, sizeof(res)), name);
+        }
+    }
+    for (size_t i = 0; i < COUNT; ++i) free(strs[i]);
+    free(blob);
+}
+
+/* =========================================================================================================================
+ * _ref_edit - Edit distance between p[0, m) and t[0, n) over the full dynamic programming table (Damerau adds the optimal
+ * string alignment transposition). With ends set the top row is all zeros, so a match may start anywhere, and ends[j]
+ * gets the cost of the best match of p ending at t[j]
+ * ========================================================================================================================*/
+
+static size_t _ref_edit(const char *p, size_t m, const char *t, size_t n, bool fold, bool damerau, size_t *ends) {
+    size_t *d = malloc((m + 1) * (n + 1) * sizeof(size_t)), w = n + 1;
+    for (size_t j = 0; j <= n; ++j) d[j] = ends ? 0 : j;
+    for (size_t i = 1; i <= m; ++i) {
+        d[i * w] = i;
+        for (size_t j = 1; j <= n; ++j) {
+            unsigned char x = (unsigned char)p[i-1], y = (unsigned char)t[j-1];
+            size_t best = d[(i-1) * w + j-1] + !(fold ? tolower(x) == tolower(y) : x == y);
+            if (d[(i-1) * w + j] + 1 < best) best = d[(i-1) * w + j] + 1;
+            if (d[i * w + j-1] + 1 < best) best = d[i * w + j-1] + 1;
+            if (damerau && i > 1 && j > 1 && d[(i-2) * w + j-2] + 1 < best) {
+                unsigned char x2 = (unsigned char)p[i-2], y2 = (unsigned char)t[j-2];
+                if (fold ? tolower(x) == tolower(y2) && tolower(x2) == tolower(y) : x == y2 && x2 == y) best = d[(i-2) * w + j-2] + 1;
+            }
+            d[i * w + j] = best;
+        }
+    }
+    if (ends) for (size_t j = 0; j <= n; ++j) ends[j] = d[m * w + j];
+    size_t dist = d[m * w + n];
+    free(d);
+    return dist;
+}
+
+/* =========================================================================================================================
+ * _fuzz_fuzzy - Edit distances, fuzzy search and strLevenshteinAll against _ref_edit. Strings run past 64 characters so
+ * the multi-block paths are covered, and now and then a candidate is too long for the 16-bit batch lanes
+ * ========================================================================================================================*/
+
+static void _fuzz_fuzzy(void) {
+    const char *alpha = _alphabets[rand() % (sizeof(_alphabets) / sizeof(*_alphabets))];
+    char a[256], b[256];
+    size_t la = (size_t)(rand() % 4 ? rand() % 70 : rand() % 200), lb = (size_t)(rand() % 4 ? rand() % 20 : rand() % 140);
+    size_t n = (size_t)(rand() % (lb + 2));                        // Edits allowed by the searches
+    _rand_str(a, la, alpha), _rand_str(b, lb, alpha);
+    if (rand() % 2) _plant(a, b, rand() % 2);
+    if (rand() % 2 && la) a[rand() % la] = alpha ? alpha[0] : 'x';  // Damage the planted copy a little
+
+    for (int fold = 0; fold < 2; ++fold) {
+        CHECK((fold ? strCaseLevenshtein(a, b) : strLevenshtein(a, b)) == _ref_edit(a, la, b, lb, fold, false, NULL),
+              fold ? "strCaseLevenshtein" : "strLevenshtein");
+        CHECK((fold ? strCaseDamerau(a, b) : strDamerau(a, b)) == _ref_edit(a, la, b, lb, fold, true, NULL),
+              fold ? "strCaseDamerau" : "strDamerau");
+
+        // The match ends at the first position within n edits, moved on while the cost keeps dropping, and starts
+        // wherever gives that cost
+        size_t ends[256], len = SIZE_MAX, end = 1;
+        char *r = fold ? strCaseFuzzyStr(a, b, n, &len) : strFuzzyStr(a, b, n, &len);
+        const char *name = fold ? "strCaseFuzzyStr" : "strFuzzyStr";
+        if (lb <= n) {
+            CHECK(r == a && len == 0, name);
+            continue;
+        }
+        _ref_edit(b, lb, a, la, fold, false, ends);
+        while (end <= la && ends[end] > n) ++end;
+        if (end > la) {
+            CHECK(!r, name);
+            continue;
+        }
+        while (end < la && ends[end + 1] < ends[end]) ++end;
+        CHECK(r && r + len == a + end && _ref_edit(b, lb, r, len, fold, false, NULL) == ends[end], name);
+    }
+
+    // One query against a set of candidates, some NULL, some far off in length and occasionally one over 32767
+    enum { COUNT = 21 };
+    char *cands[COUNT];
+    size_t dists[COUNT], m = lb < 20 || rand() % 2 ? lb % 20 : lb, max = (size_t)(rand() % 4 ? rand() % 8 : rand() % 2 ? rand() % 200 : 100000);
+    bool fold = rand() % 2;
+    b[m] = '\0';
+    for (size_t i = 0; i < COUNT; ++i) {
+        size_t len = rand() % 8 == 0 ? (size_t)(40000 + rand() % 100) : rand() % 4 ? m + (size_t)(rand() % 5) : (size_t)(rand() % 100);
+        if (len >= 40000 && rand() % 8) len = (size_t)(rand() % 30);
+        cands[i] = rand() % 16 ? malloc(len + 1) : NULL;
+        if (cands[i]) _rand_str(cands[i], len, alpha);
+        if (cands[i] && rand() % 2) _plant(cands[i], b, true);
+    }
+    size_t within = strLevenshteinAll(b, cands, COUNT, max, dists, fold), expect = 0;
+    for (size_t i = 0; i < COUNT; ++i) {
+        size_t len = cands[i] ? strlen(cands[i]) : 0, d = max + 1;
+        if (cands[i] && (len > m ? len - m : m - len) <= max) d = _ref_edit(b, m, cands[i], len, fold, false, NULL);
+        expect += d <= max;
+        CHECK(dists[i] == d, "strLevenshteinAll");
+        free(cands[i]);
+    }
+    CHECK(within == expect, "strLevenshteinAll (count)");
+}
+
+/* =========================================================================================================================
+ * _fuzz_anagram - Builds an index from random short words (repeats and NULL batch entries included) with strAnagramAdd
+ * and strAnagramAddAll, then checks the adds, strAnagramFind, the group count and the export against pairwise strIsPerm /
+ * strCaseIsPerm over the distinct words in insertion order
+ * ========================================================================================================================*/
+
+static bool _ref_added(const char **added, size_t count, const char *word) {
+    for (size_t i = 0; i < count; ++i) if (!strcmp(added[i], word)) return true;
+    return false;
+}
+
+static void _fuzz_anagram(void) {
+    enum { COUNT = 48 };
+    char words[COUNT][8], *batch[2 * COUNT], a[8] = "", b[8] = "", *out = NULL;
+    const char *added[COUNT], *found[COUNT];
+    size_t count = 0, n = 0, in_batch = 0, expect = 0, groups = 0, out_len = 0;
+    bool fold = rand() % 2;
+    bool (*perm)(const char *, const char *) = fold ? strCaseIsPerm : strIsPerm;
+    StrAnagramIndex *index = strAnagramCreate(fold);
+    if (!index) {
+        _fail("strAnagramCreate", a, b, n);
+        return;
+    }
+
+    for (size_t i = 0; i < COUNT; ++i) {
+        bool direct = rand() % 2;
+        if (in_batch && (direct || rand() % 4 == 0)) {            // Flushed before a direct add to keep the order
+            n = in_batch;
+            CHECK(strAnagramAddAll(index, batch, in_batch) == expect, "strAnagramAddAll");
+            in_batch = expect = 0;
+        }
+        _rand_str(words[i], (size_t)(rand() % 6), "aAbc");
+        strcpy(a, words[i]);
+        bool fresh = !_ref_added(added, count, words[i]);
+        if (fresh) added[count++] = words[i];
+        if (direct) {
+            CHECK(strAnagramAdd(index, words[i]) == fresh, "strAnagramAdd");
+        } else {                                                   // Queued for the next strAnagramAddAll
+            if (rand() % 4 == 0) batch[in_batch++] = NULL;
+            batch[in_batch++] = words[i];
+            expect += fresh;
+        }
+    }
+    n = in_batch;
+    CHECK(strAnagramAddAll(index, batch, in_batch) == expect, "strAnagramAddAll");
+
+    FILE *stream = open_memstream(&out, &out_len);
+    size_t min_size = (size_t)(rand() % 4), written = 0;
+    char *expect_out = malloc(COUNT * 8 + 1), *e = expect_out;
+    for (size_t i = 0; i < count; ++i) {
+        size_t total = 0, leader = i;                              // leader: the first word of i's class
+        for (size_t k = 0; k < i && leader == i; ++k) if (perm(added[k], added[i])) leader = k;
+        for (size_t k = 0; k < count; ++k) total += perm(added[k], added[i]);
+        groups += leader == i;
+        if (leader == i && total >= min_size) {
+            for (size_t k = i, first = 1; k < count; ++k)
+                if (perm(added[k], added[i])) e += sprintf(e, "%s%s", first ? "" : " ", added[k]), first = 0;
+            *e++ = '\n', ++written;
+        }
+
+        strcpy(a, added[i]), n = total;
+        size_t max = (size_t)(rand() % (COUNT + 1));
+        CHECK(strAnagramFind(index, added[i], found, max) == total, "strAnagramFind");
+        for (size_t k = 0, j = 0; k < count && j < max && j < total; ++k)
+            if (perm(added[k], added[i])) CHECK(!strcmp(found[j++], added[k]), "strAnagramFind (order)");
+    }
+    *e = '\0';
+    _rand_str(a, (size_t)(rand() % 6), "aAbcd");                   // A query that may not be in any group
+    n = 0;
+    for (size_t k = 0; k < count; ++k) n += perm(added[k], a);
+    CHECK(strAnagramFind(index, a, found, COUNT) == n, "strAnagramFind (query)");
+
+    a[0] = '\0', n = groups;
+    CHECK(strAnagramGroupCount(index) == groups, "strAnagramGroupCount");
+    n = written;
+    CHECK(stream && strAnagramExport(index, stream, min_size) == written, "strAnagramExport");
+    if (stream) fclose(stream);
+    CHECK(out && !strcmp(out, expect_out), "strAnagramExport (lines)");
+    free(out), free(expect_out);
+    strAnagramDestroy(index);
+}
+
+/* =========================================================================================================================
+ * _fuzz_builder - Runs a random sequence of appends, inserts and formats on a StrBuilder, mirrored on a plain buffer. About
+ * a third of the sources point into the builder's own data (which the call may move while growing), and the contents,
+ * length and capacity are compared after every step
+ * ========================================================================================================================*/
+
+static void _fuzz_builder(void) {
+    static char ref[4 * MAX_LEN + 64], src[4 * MAX_LEN + 64], tmp[4 * MAX_LEN + 64];
+    char a[32] = "", b[32] = "";
+    size_t len = 0, n = 0;
+    StrBuilder sb;
+    CHECK(strBuilderInit(&sb, (size_t)(rand() % 2 * rand() % 64)), "strBuilderInit");
+    ref[0] = '\0';
+
+    for (int step = 0; step < 64; ++step) {
+        int op = rand() % 9;
+        bool self = len && rand() % 3 == 0;
+        const char *source = src;
+        if (self) {                                                // A suffix of the builder's own string
+            size_t off = (size_t)rand() % (len + 1);
+            strcpy(src, ref + off), source = sb.data + off;
+        } else {
+            _rand_str(src, (size_t)rand() % 80, _alphabets[rand() % 5]);
+        }
+        size_t sn = strlen(src), idx = (size_t)rand() % (len + 1);
+        char ch = src[0] ? src[0] : 'Q';
+        n = (size_t)op, snprintf(a, sizeof a, "%s%zu", self ? "self " : "", idx);
+        switch (op) {
+        case 0:
+            CHECK(strBuilderAppend(&sb, source), "strBuilderAppend");
+            memcpy(ref + len, src, sn + 1), len += sn;
+            break;
+        case 1:
+            sn = sn ? (size_t)rand() % (sn + 1) : 0;
+            CHECK(strBuilderAppendN(&sb, source, sn), "strBuilderAppendN");
+            memcpy(ref + len, src, sn), ref[len += sn] = '\0';
+            break;
+        case 2:
+            CHECK(strBuilderCaseAppend(&sb, source), "strBuilderCaseAppend");
+            _ref_fold(ref + len, src, sn + 1, false), len += sn;
+            break;
+        case 3:
+            CHECK(strBuilderAppendChar(&sb, ch), "strBuilderAppendChar");
+            ref[len++] = ch, ref[len] = '\0';
+            break;
+        case 4:
+            CHECK(strBuilderCaseAppendChar(&sb, ch), "strBuilderCaseAppendChar");
+            ref[len++] = (char)tolower((unsigned char)ch), ref[len] = '\0';
+            break;
+        case 5: case 6:
+            CHECK(strBuilderInsert(&sb, idx, source), "strBuilderInsert");
+            strcpy(tmp, ref + idx), strcpy(ref + idx, src), strcpy(ref + idx + sn, tmp), len += sn;
+            break;
+        case 7:                                                    // Never from itself: vsnprintf can't alias its output
+            CHECK(strBuilderFormat(&sb, "%s|%zu|%.*s", src, sn, (int)(sn / 2), src), "strBuilderFormat");
+            len += (size_t)sprintf(ref + len, "%s|%zu|%.*s", src, sn, (int)(sn / 2), src);
+            break;
+        case 8:
+            CHECK(!strBuilderInsert(&sb, len + 1, "x"), "strBuilderInsert (past the end)");
+            if (rand() % 2) CHECK(strBuilderShrink(&sb) && sb.cap == len, "strBuilderShrink");
+            else CHECK(strBuilderReserve(&sb, len + (size_t)rand() % 100), "strBuilderReserve");
+            break;
+        }
+        if (len > MAX_LEN) strBuilderClear(&sb), len = 0, ref[0] = '\0';
+        CHECK(!strcmp(strBuilderStr_(&sb), ref) && strBuilderLen_(&sb) == len && sb.cap >= len, "strBuilder (contents)");
+        if (failures > 25) break;
+    }
+    size_t out_len = 0;
+    char *out = strBuilderRelease(&sb, &out_len);
+    CHECK(out && out_len == len && !strcmp(out, ref) && !sb.data && !sb.len, "strBuilderRelease");
+    free(out);
+}
+
+/* =========================================================================================================================
+ * _ref_glob - Backtracking glob matcher following the grammar in strpattern.h. The pattern is parsed into a list of
+ * stars and 256-entry sets, then tried at every start (only the first if anchored) with each star taking every length.
+ * Returns -1 for a pattern strPatCompile must reject
+ * ========================================================================================================================*/
+
+typedef struct { bool star, in[256]; } _RefTok;
+
+static bool _ref_glob_at(const _RefTok *t, size_t nt, const unsigned char *s, size_t n, bool anchor_end) {
+    if (!nt) return !anchor_end || !n;
+    if (t->star) {
+        for (size_t k = 0; k <= n; ++k) if (_ref_glob_at(t + 1, nt - 1, s + k, n - k, anchor_end)) return true;
+        return false;
+    }
+    return n && t->in[*s] && _ref_glob_at(t + 1, nt - 1, s + 1, n - 1, anchor_end);
+}
+
+static int _ref_glob(const char *pattern, const char *str, size_t n, bool fold) {
+    static _RefTok tok[2 * MAX_LEN];
+    size_t nt = 0, positions = 0, len = strlen(pattern);
+    const unsigned char *p = (const unsigned char *)pattern, *end = p + len;
+    bool anchor_start = len && *p == '^', anchor_end = false;
+    p += anchor_start;
+    while (p < end) {
+        if (*p == '$' && p + 1 == end) { anchor_end = true; break; }
+        _RefTok *t = &tok[nt++];
+        memset(t, 0, sizeof *t);
+        if (*p == '*') { t->star = true, ++p; continue; }
+        bool raw[256] = { false }, negate = false;
+        if (*p == '?') {
+            memset(raw, true, sizeof raw), ++p;
+        } else if (*p == '[') {
+            const unsigned char *q = p + 1;
+            negate = *q == '!' || *q == '^';
+            q += negate;
+            const unsigned char *first = q;
+            for (;;) {
+                if (q == end) return -1;                           // Unterminated set
+                if (*q == ']' && q != first) break;
+                unsigned char lo = *q++;
+                if (lo == '\\' && q < end) lo = *q++;
+                unsigned char hi = lo;
+                if (q + 1 < end && *q == '-' && q[1] != ']') {
+                    hi = q[1], q += 2;
+                    if (hi == '\\' && q < end) hi = *q++;
+                }
+                for (unsigned c = lo; c <= hi; ++c) raw[c] = true;
+            }
+            p = q + 1;
+        } else {
+            if (*p == '\\' && p + 1 < end) ++p;
+            raw[*p++] = true;
+        }
+        for (unsigned c = 0; c < 256; ++c) {
+            bool in = raw[c] || (fold && isalpha((int)c) && raw[c ^ 0x20]);
+            t->in[c] = in != negate;
+        }
+        ++positions;
+    }
+    if (positions > STRPATTERN_MAX) return -1;
+    if (nt && tok[0].star) anchor_start = false;                  // A star at either end lifts that end's anchor
+    if (nt && tok[nt - 1].star) anchor_end = false;
+    const unsigned char *s = (const unsigned char *)str;
+    for (size_t k = 0; k <= n; ++k) {
+        if (_ref_glob_at(tok, nt, s + k, n - k, anchor_end)) return 1;
+        if (anchor_start) break;
+    }
+    return 0;
+}
+
+/* =========================================================================================================================
+ * _fuzz_pattern - Random patterns built from literals, escapes, '?', '*', classes (ranges, negation, a leading ']', '-'
+ * at either end) and anchors, matched against short strings over the same characters, compared with _ref_glob. Also
+ * runs strPatMatchN on a prefix, strPatMatchAll, and patterns over STRPATTERN_MAX positions or with an unclosed set
+ * ========================================================================================================================*/
+
+static void _fuzz_pattern(void) {
+    static const char *pieces[] = {
+        "a", "b", "A", "B", "-", "]", "$", "^", "\\*", "\\?", "\\[", "\\\\", "\\a", "\\$", "?", "*", "**",
+        "[ab]", "[!a]", "[^aB]", "[a-b]", "[A-Z]", "[!a-z]", "[]a]", "[!]]", "[a-]", "[-b]", "[\\]a]", "[\\--\\]]", "[b-a]",
+        "[\xe9\xc9]", "[^\x80-\xff]"
+    };
+    char a[512], b[64];
+    size_t n = 0;
+    bool fold = rand() % 2;
+    a[0] = '\0';
+    if (rand() % 3 == 0) strcat(a, "^");
+    for (int k = rand() % 8; k >= 0; --k) strcat(a, pieces[rand() % (sizeof(pieces) / sizeof(*pieces))]);
+    if (rand() % 3 == 0) strcat(a, rand() % 4 ? "$" : "\\");
+    if (rand() % 32 == 0) strcat(a, "[ab");                        // Unterminated set
+    if (rand() % 32 == 0) for (int k = 0; k < 60 + rand() % 8; ++k) strcat(a, "?");
+    _rand_str(b, (size_t)(rand() % 14), rand() % 2 ? "aAbB" : "abAB-]*?[\\$^\xe9");
+    n = strlen(b);
+
+    int expect = _ref_glob(a, b, n, fold);
+    StrPattern pat;
+    bool compiled = fold ? strCasePatCompile(&pat, a) : strPatCompile(&pat, a);
+    CHECK(compiled == (expect >= 0) && (compiled || pat.error), "strPatCompile");
+    CHECK((fold ? strCaseGlob(a, b) : strGlob(a, b)) == (expect == 1), fold ? "strCaseGlob" : "strGlob");
+    if (!compiled) return;
+
+    n = (size_t)rand() % (strlen(b) + 1);
+    CHECK(strPatMatchN(&pat, b, n) == (_ref_glob(a, b, n, fold) == 1), "strPatMatchN");
+    char *strs[3] = { b, NULL, a };
+    bool results[3];
+    n = (size_t)(expect == 1) + (size_t)(_ref_glob(a, a, strlen(a), fold) == 1);
+    CHECK(strPatMatchAll(&pat, strs, 3, results) == n && !results[1], "strPatMatchAll");
+}
+
+/* =========================================================================================================================
+ * _fuzz_intern - Several threads intern the same words (a few longer than an arena block) in different orders with
+ * strIntern, strInternN and strCaseIntern. Each publishes its handles in a shared table, and a slot already set must
+ * hold the same handle. Between inserts, each thread also resolves handles another thread published, which reads shards
+ * that are still growing without a lock. Afterwards every handle must be unique per word and resolve to that word
+ * ========================================================================================================================*/
+
+#define INTERN_WORDS 12000
+#define INTERN_THREADS 4
+
+static char *_words[INTERN_WORDS];
+static _Atomic StrHandle _published[INTERN_WORDS];
+
+typedef struct {
+    StrInternPool *pool;
+    unsigned int seed;
+    size_t start;
+    unsigned long errors;
+} _InternArgs;
+
+static void *_intern_thread(void *arg) {
+    _InternArgs *t = arg;
+    char copy[128];
+    for (size_t k = 0; k < INTERN_WORDS; ++k) {
+        size_t j = (t->start + k * 7919) % INTERN_WORDS, len = strlen(_words[j]);
+        StrHandle h;
+        switch (rand_r(&t->seed) % 3) {
+        case 0: h = strIntern(t->pool, _words[j]); break;
+        case 1:                                                    // Only the first len characters count
+            if (len + 8 >= sizeof copy) h = strInternN(t->pool, _words[j], len);
+            else sprintf(copy, "%s%s", _words[j], "XYZ\xff"), h = strInternN(t->pool, copy, len);
+            break;
+        default:                                                   // The words are lowercase already
+            if (len >= sizeof copy) h = strCaseIntern(t->pool, _words[j]);
+            else _ref_fold(copy, _words[j], len + 1, true), h = strCaseIntern(t->pool, copy);
+        }
+        StrHandle expect = STRINTERN_NONE;
+        if (h == STRINTERN_NONE || (!atomic_compare_exchange_strong(&_published[j], &expect, h) && expect != h)) ++t->errors;
+        if (strInternFind(t->pool, _words[j]) != h) ++t->errors;
+
+        size_t r = (size_t)rand_r(&t->seed) % INTERN_WORDS;       // Possibly interned by another thread just now
+        StrHandle other = atomic_load(&_published[r]);
+        if (other != STRINTERN_NONE && (strcmp(strInternStr(t->pool, other), _words[r])
+                                        || strInternLen(t->pool, other) != strlen(_words[r]))) ++t->errors;
+    }
+    return NULL;
+}
+
+static void _fuzz_intern(void) {
+    char a[32] = "", b[32] = "";
+    size_t n = 0;
+    StrInternPool *pool = strInternCreate();
+    pthread_t threads[INTERN_THREADS];
+    _InternArgs args[INTERN_THREADS];
+    for (size_t j = 0; j < INTERN_WORDS; ++j) {
+        size_t len = j % 3001 == 0 ? 70000 + (size_t)rand() % 100 : (size_t)rand() % 40;
+        _words[j] = malloc(len + 32);
+        int head = sprintf(_words[j], "%zu:", j);
+        _rand_str(_words[j] + head, len, "abcdefghijklmnopqrstuvwxyz");
+        atomic_init(&_published[j], STRINTERN_NONE);
+    }
+    for (int i = 0; i < INTERN_THREADS; ++i) {
+        args[i] = (_InternArgs){ pool, (unsigned int)rand(), (size_t)rand() % INTERN_WORDS, 0 };
+        pthread_create(&threads[i], NULL, _intern_thread, &args[i]);
+    }
+    for (int i = 0; i < INTERN_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+        n = args[i].errors;
+        CHECK(!n, "strIntern (threads disagree)");
+    }
+
+    StrHandle *sorted = malloc(INTERN_WORDS * sizeof(StrHandle));
+    for (size_t j = 0; j < INTERN_WORDS; ++j) {
+        StrHandle h = sorted[j] = atomic_load(&_published[j]);
+        n = j;
+        CHECK(h != STRINTERN_NONE && !strcmp(strInternStr(pool, h), _words[j]), "strInternStr");
+    }
+    qsort(sorted, INTERN_WORDS, sizeof(StrHandle), _cmp_handle);
+    for (size_t j = 1; j < INTERN_WORDS; ++j) {
+        n = j;
+        CHECK(sorted[j] != sorted[j - 1], "strIntern (duplicate handle)");
+    }
+    n = strInternCount(pool);
+    CHECK(n == INTERN_WORDS, "strInternCount");
+    for (size_t j = 0; j < INTERN_WORDS; ++j) free(_words[j]);
+    free(sorted);
+    strInternDestroy(pool);
+}
+
+int main(int argc, char **argv) {
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    unsigned int seed = argc > 2 ? (unsigned int)strtoul(argv[2], NULL, 10) : (unsigned int)time(NULL);
+    srand(seed);
+
+    _page = (size_t)sysconf(_SC_PAGESIZE);
+    _guard = mmap(NULL, 2 * _page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (_guard == MAP_FAILED || mprotect(_guard + _page, _page, PROT_NONE)) return perror("mmap"), 2;
+
+    for (unsigned long i = 0; i < iterations; ++i) {
+        _fuzz_one();
+        if (i % 16 == 0) _fuzz_fuzzy(), _fuzz_builder();
+        if (i % 4 == 0) _fuzz_pattern();
+        if (i % 256 == 0) _fuzz_perms(), _fuzz_hash(), _fuzz_batch(), _fuzz_anagram();
+        if (i % 8192 == 0) _fuzz_intern();
+    }
+    printf("%lu iterations, seed %u: %lu failures\n", iterations, seed, failures);
+    return failures != 0;
+}
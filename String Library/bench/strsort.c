@@ -0,0 +1,95 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strsort.c                                                                                                               *
+ *                                                                                                                         *
+ * Measures the crossover points strSort uses to pick its method: insertion sort against the single-table counting sort    *
+ * (STRSORT_INSERTION_MAX), and the single-table count against strCountSort's histogram kernel (STRSORT_SMALL_COUNT_MAX).  *
+ * Includes strings.c to reach the static kernels. Each length is timed on letters (narrow bucket range) and on random     *
+ * bytes (full range), as ns per string (best of three runs), and the first length where the next method wins is printed.  *
+ *                                                                                                                         *
+ * Build (from this directory):                                                                                            *
+ *     gcc -O2 strsort.c -lm -pthread -o strsort                                                                           *
+ * Run: ./strsort                                                                                                          *
+ * ======================================================================================================================= */
+
+#include "../strings.c"
+
+#define SORT_BYTES (1 << 20)            // Input bytes per timed pass
+#define RUN_SECONDS 0.02                // Minimum duration of one timed run
+
+typedef void (*_SortFn)(unsigned char *s, size_t n);
+
+static void _count_sort(unsigned char *s, size_t n) {
+    (void)n;
+    strCountSort((char *)s);
+}
+
+static unsigned char _src[SORT_BYTES + 1], _dst[SORT_BYTES + 1];
+static volatile unsigned char _sink;
+
+static double _now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* =========================================================================================================================
+ * _time - ns per string for sorting every n character string of _src with fn (a copy first, as strSort works in place)
+ * ========================================================================================================================*/
+
+static double _time(_SortFn fn, size_t n) {
+    size_t strings = SORT_BYTES / (n + 1);
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+        size_t passes = 0;
+        double start = _now(), elapsed;
+        do {
+            for (size_t i = 0; i < strings; ++i) {
+                unsigned char *s = _dst + i * (n + 1);
+                memcpy(s, _src + i * (n + 1), n + 1);
+                fn(s, n);
+                _sink ^= s[0];
+            }
+            ++passes;
+        } while ((elapsed = _now() - start) < RUN_SECONDS);
+        if (elapsed / (double)(passes * strings) < best) best = elapsed / (double)(passes * strings);
+    }
+    return best * 1e9;
+}
+
+static void _fill(size_t n, bool letters) {
+    for (size_t i = 0; i < SORT_BYTES; ++i) {
+        _src[i] = (unsigned char)(letters ? 'a' + rand() % 26 : 1 + rand() % 255);
+        if (i % (n + 1) == n) _src[i] = '\0';
+    }
+}
+
+/* =========================================================================================================================
+ * _sweep - Times a against b over the given lengths and prints the first length where b is faster (for both alphabets)
+ * ========================================================================================================================*/
+
+static void _sweep(const char *name_a, _SortFn a, const char *name_b, _SortFn b, const size_t *lens, size_t count) {
+    printf("\n%8s   %-10s %14s %14s   %-10s %14s %14s\n", "length", "letters", name_a, name_b, "bytes", name_a, name_b);
+    size_t cross[2] = { 0, 0 };
+    for (size_t k = 0; k < count; ++k) {
+        double t[2][2];
+        for (int letters = 1; letters >= 0; --letters) {
+            _fill(lens[k], letters);
+            t[letters][0] = _time(a, lens[k]), t[letters][1] = _time(b, lens[k]);
+            if (!cross[letters] && t[letters][1] < t[letters][0]) cross[letters] = lens[k];
+        }
+        printf("%8zu   %-10s %11.1f ns %11.1f ns   %-10s %11.1f ns %11.1f ns\n", lens[k], "", t[1][0], t[1][1], "", t[0][0], t[0][1]);
+    }
+    printf("%s overtakes %s at: letters %zu, bytes %zu (0 = not in range)\n", name_b, name_a, cross[1], cross[0]);
+}
+
+int main(void) {
+    static const size_t small[] = { 4, 8, 12, 16, 20, 24, 28, 32, 40, 48, 56, 64, 80, 96, 128 };
+    static const size_t large[] = { 256, 512, 768, 1024, 1280, 1536, 2048, 3072, 4096, 8192, 16384 };
+    srand(1);
+    printf("strSort crossovers (STRSORT_INSERTION_MAX = %d, STRSORT_SMALL_COUNT_MAX = %d)\n", STRSORT_INSERTION_MAX,
+           STRSORT_SMALL_COUNT_MAX);
+    _sweep("insertion", _insertion_sort, "small count", _small_count_sort, small, sizeof(small) / sizeof(*small));
+    _sweep("small count", _small_count_sort, "strCountSort", _count_sort, large, sizeof(large) / sizeof(*large));
+    return (int)(_sink & 0);
+}
@@ -0,0 +1,264 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * stranagram.c                                                                                                            *
+ * ======================================================================================================================= */
+
+#define _GNU_SOURCE                     // pthread_rwlock_t
+
+#include <string.h>
+#include <pthread.h>
+#include "stranagram.h"
+#include "strintern.h"
+#include "strhash.h"
+
+/* =========================================================================================================================
+ * _AnagramGroup - One anagram class: its signature and the handles of its words, in insertion order
+ * ========================================================================================================================*/
+
+typedef struct {
+    uint64_t sig;
+    StrHandle *words;
+    size_t count, space;
+} _AnagramGroup;
+
+struct StrAnagramIndex {
+    pthread_rwlock_t lock;
+    StrInternPool *pool;
+    bool fold;
+    uint64_t weights[EXTENDED_ASCII_RANGE];                     // Random per index, so signatures can't be steered
+    _AnagramGroup *groups;
+    size_t count, space;
+    uint32_t *slots;                                            // Open addressing table of group index + 1 (0 = empty)
+    size_t mask;
+};
+
+/* =========================================================================================================================
+ * _signature - Order independent signature of word[0, n): the sum of its characters' weights
+ * ========================================================================================================================*/
+
+static inline uint64_t _signature(const StrAnagramIndex *index, const char *word, size_t n) {
+    const unsigned char *s = (const unsigned char *)word;
+    uint64_t sig = 0;
+    if (index->fold) for (size_t i = 0; i < n; ++i) sig += index->weights[lc(s[i])];
+    else for (size_t i = 0; i < n; ++i) sig += index->weights[s[i]];
+    return sig;
+}
+
+/* =========================================================================================================================
+ * _same_letters - Exact anagram check for two strings of length n. Counts up for a and down for b, touching only the
+ * counters of characters that occur, so it is O(n) rather than O(n + 256) like two full histograms
+ * ========================================================================================================================*/
+
+static bool _same_letters(const char *a, const char *b, size_t n, bool fold) {
+    const unsigned char *x = (const unsigned char *)a, *y = (const unsigned char *)b;
+    int32_t counts[EXTENDED_ASCII_RANGE];
+    for (size_t i = 0; i < n; ++i) {
+        counts[fold ? lc(x[i]) : x[i]] = 0;
+        counts[fold ? lc(y[i]) : y[i]] = 0;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        ++counts[fold ? lc(x[i]) : x[i]];
+        --counts[fold ? lc(y[i]) : y[i]];
+    }
+    for (size_t i = 0; i < n; ++i) if (counts[fold ? lc(x[i]) : x[i]]) return false;
+    return true;
+}
+
+/* =========================================================================================================================
+ * _find_group - Returns the group word[0, n) belongs to, or NULL. *slot gets the table slot where the group is or would
+ * be stored. Call with the lock held
+ * ========================================================================================================================*/
+
+static _AnagramGroup *_find_group(StrAnagramIndex *index, const char *word, size_t n, uint64_t sig, size_t *slot) {
+    size_t i = (size_t)(sig ^ sig >> 32) & index->mask;
+    for (; index->slots[i]; i = (i + 1) & index->mask) {
+        _AnagramGroup *g = &index->groups[index->slots[i] - 1];
+        if (g->sig != sig) continue;
+        const char *rep = strInternStr(index->pool, g->words[0]);
+        if (strInternLen(index->pool, g->words[0]) == n && _same_letters(rep, word, n, index->fold)) {
+            *slot = i;
+            return g;
+        }
+    }
+    *slot = i;
+    return NULL;
+}
+
+/* =========================================================================================================================
+ * _grow - Doubles the slot table, keeping it at most half full. Call with the write lock held
+ * ========================================================================================================================*/
+
+static bool _grow(StrAnagramIndex *index) {
+    size_t mask = index->mask * 2 + 1;
+    uint32_t *slots = calloc(mask + 1, sizeof(uint32_t));
+    if (!slots) return false;
+    for (size_t g = 0; g < index->count; ++g) {
+        uint64_t sig = index->groups[g].sig;
+        size_t i = (size_t)(sig ^ sig >> 32) & mask;
+        while (slots[i]) i = (i + 1) & mask;
+        slots[i] = (uint32_t)(g + 1);
+    }
+    free(index->slots);
+    index->slots = slots, index->mask = mask;
+    return true;
+}
+
+/* =========================================================================================================================
+ * _add - Adds word[0, n) with signature sig. Call with the write lock held. Returns false if the word was already in the
+ * index or memory runs out
+ * ========================================================================================================================*/
+
+static bool _add(StrAnagramIndex *index, const char *word, size_t n, uint64_t sig) {
+    bool known = strInternFind(index->pool, word) != STRINTERN_NONE;
+    StrHandle handle = strInternN(index->pool, word, n);
+    if (handle == STRINTERN_NONE) return false;
+
+    size_t slot;
+    _AnagramGroup *g = _find_group(index, word, n, sig, &slot);
+    if (g && known) {                                           // Only a word seen before can already be in its group
+        for (size_t i = 0; i < g->count; ++i) if (g->words[i] == handle) return false;
+    }
+    if (!g) {
+        if ((index->count + 1) * 2 > index->mask + 1) {
+            if (!_grow(index)) return false;
+            _find_group(index, word, n, sig, &slot);
+        }
+        if (index->count == index->space) {
+            size_t space = index->space ? index->space * 2 : 64;
+            _AnagramGroup *groups = realloc(index->groups, space * sizeof(_AnagramGroup));
+            if (!groups) return false;
+            index->groups = groups, index->space = space;
+        }
+        g = &index->groups[index->count];
+        *g = (_AnagramGroup){ sig, NULL, 0, 0 };
+        index->slots[slot] = (uint32_t)++index->count;
+    }
+    if (g->count == g->space) {
+        size_t space = g->space ? g->space * 2 : 2;
+        StrHandle *words = realloc(g->words, space * sizeof(StrHandle));
+        if (!words) return false;
+        g->words = words, g->space = space;
+    }
+    g->words[g->count++] = handle;
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strAnagramCreate - Creates an empty index. Returns NULL if memory runs out
+ * *************************************************************************************************************************/
+
+StrAnagramIndex *strAnagramCreate(bool fold) {
+    StrAnagramIndex *index = calloc(1, sizeof(StrAnagramIndex));
+    if (!index) return NULL;
+    index->mask = 63;
+    if (!(index->pool = strInternCreate()) || !(index->slots = calloc(index->mask + 1, sizeof(uint32_t)))
+        || pthread_rwlock_init(&index->lock, NULL)) {
+        strInternDestroy(index->pool);
+        free(index->slots);
+        free(index);
+        return NULL;
+    }
+    index->fold = fold;
+    uint64_t seed = strHashSeed();
+    for (int c = 0; c < EXTENDED_ASCII_RANGE; ++c) index->weights[c] = strHashN(&c, sizeof(c), seed) | 1;
+    return index;
+}
+
+/* *************************************************************************************************************************
+ * strAnagramDestroy - Frees the index and its words. Pointers returned by strAnagramFind become invalid
+ * *************************************************************************************************************************/
+
+void strAnagramDestroy(StrAnagramIndex *index) {
+    if (!index) return;
+    for (size_t g = 0; g < index->count; ++g) free(index->groups[g].words);
+    free(index->groups);
+    free(index->slots);
+    strInternDestroy(index->pool);
+    pthread_rwlock_destroy(&index->lock);
+    free(index);
+}
+
+/* *************************************************************************************************************************
+ * strAnagramAdd - Adds word to its anagram group. Returns false if it was already in the index or memory runs out
+ * *************************************************************************************************************************/
+
+bool strAnagramAdd(StrAnagramIndex *index, const char *word) {
+    size_t n = strlen(word);
+    uint64_t sig = _signature(index, word, n);
+    pthread_rwlock_wrlock(&index->lock);
+    bool added = _add(index, word, n, sig);
+    pthread_rwlock_unlock(&index->lock);
+    return added;
+}
+
+/* *************************************************************************************************************************
+ * strAnagramAddAll - Adds every word (NULL entries are skipped). Signatures are computed before the write lock is taken,
+ * which is then held once for the whole batch. Returns the number of words added
+ * *************************************************************************************************************************/
+
+size_t strAnagramAddAll(StrAnagramIndex *index, char **words, size_t n) {
+    uint64_t *sigs = malloc((n ? n : 1) * sizeof(uint64_t));
+    size_t added = 0;
+    if (!sigs) return 0;
+    for (size_t i = 0; i < n; ++i) if (words[i]) sigs[i] = _signature(index, words[i], strlen(words[i]));
+
+    pthread_rwlock_wrlock(&index->lock);
+    for (size_t i = 0; i < n; ++i) if (words[i]) added += _add(index, words[i], strlen(words[i]), sigs[i]);
+    pthread_rwlock_unlock(&index->lock);
+    free(sigs);
+    return added;
+}
+
+/* *************************************************************************************************************************
+ * strAnagramFind - Finds the words in the index that are permutations of word (word itself included if it was added).
+ * Stores up to max of them in words, in insertion order, and returns how many there are in total. The stored pointers
+ * stay valid until the index is destroyed. Safe to call from several threads at once
+ * *************************************************************************************************************************/
+
+size_t strAnagramFind(StrAnagramIndex *index, const char *word, const char **words, size_t max) {
+    size_t n = strlen(word), slot, total = 0;
+    uint64_t sig = _signature(index, word, n);
+    pthread_rwlock_rdlock(&index->lock);
+    _AnagramGroup *g = _find_group(index, word, n, sig, &slot);
+    if (g) {
+        total = g->count;
+        for (size_t i = 0; i < total && i < max; ++i) words[i] = strInternStr(index->pool, g->words[i]);
+    }
+    pthread_rwlock_unlock(&index->lock);
+    return total;
+}
+
+/* *************************************************************************************************************************
+ * strAnagramGroupCount - Returns the number of anagram groups
+ * *************************************************************************************************************************/
+
+size_t strAnagramGroupCount(StrAnagramIndex *index) {
+    pthread_rwlock_rdlock(&index->lock);
+    size_t count = index->count;
+    pthread_rwlock_unlock(&index->lock);
+    return count;
+}
+
+/* *************************************************************************************************************************
+ * strAnagramExport - Writes every group of at least min_size words to stream, one group per line with its words
+ * separated by spaces. Returns the number of groups written
+ * *************************************************************************************************************************/
+
+size_t strAnagramExport(StrAnagramIndex *index, FILE *stream, size_t min_size) {
+    size_t written = 0;
+    pthread_rwlock_rdlock(&index->lock);
+    for (size_t g = 0; g < index->count; ++g) {
+        const _AnagramGroup *group = &index->groups[g];
+        if (group->count < min_size) continue;
+        for (size_t i = 0; i < group->count; ++i) {
+            if (i) putc(' ', stream);
+            fputs(strInternStr(index->pool, group->words[i]), stream);
+        }
+        putc('\n', stream);
+        ++written;
+    }
+    pthread_rwlock_unlock(&index->lock);
+    return written;
+}
+
+/* *************************************************************************************************************************/
@@ -0,0 +1,45 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * stranagram.h                                                                                                            *
+ *                                                                                                                         *
+ * Anagram index. Words are grouped by anagram class (the strings strIsPerm considers equal) so that finding every         *
+ * permutation of a word is one O(length) lookup instead of a strIsPerm call per stored word. The class signature is the   *
+ * sum of a random 64-bit weight per character, which doesn't depend on character order, so no sorting is needed; a        *
+ * matching signature is confirmed with an exact O(length) letter count before a group is used. Words are stored in a      *
+ * StrInternPool, once each. Lookups may run concurrently with each other; inserts wait for them (read/write lock).        *
+ * ======================================================================================================================= */
+
+#ifndef stranagram_h
+#define stranagram_h
+
+#include <stdint.h>
+#include "strings.h"
+
+/* *************************************************** TYPEDEFS ************************************************************/
+typedef struct StrAnagramIndex StrAnagramIndex;
+
+/* *************************************************************************************************************************/
+// No macro versions. A case insensitive index (fold set) groups words the way strCaseIsPerm does
+
+extern StrAnagramIndex *strAnagramCreate(bool fold);
+extern void strAnagramDestroy(StrAnagramIndex *index);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern bool strAnagramAdd(StrAnagramIndex *index, const char *word);
+extern size_t strAnagramAddAll(StrAnagramIndex *index, char **words, size_t n);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern size_t strAnagramFind(StrAnagramIndex *index, const char *word, const char **words, size_t max);
+extern size_t strAnagramGroupCount(StrAnagramIndex *index);
+extern size_t strAnagramExport(StrAnagramIndex *index, FILE *stream, size_t min_size);
+/* *************************************************************************************************************************/
+
+#endif /* stranagram_h */
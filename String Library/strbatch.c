@@ -0,0 +1,231 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strbatch.c                                                                                                              *
+ * ======================================================================================================================= */
+
+#define _GNU_SOURCE                     // memmem
+
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "strbatch.h"
+#include "strhash.h"
+#include "strsimd.h"                    // _simd_lc
+
+/* =========================================================================================================================
+ * _BatchOp / _BatchTask - The operation being applied and the slice of the batch [begin, end) one thread works on
+ * ========================================================================================================================*/
+
+typedef enum {LWR, UPR, HASH, EQUALS, CASE_EQUALS, CONTAINS, HAS_DUPS, CASE_HAS_DUPS} _BatchOp;
+
+typedef struct {
+    const StrBatch *batch;
+    _BatchOp op;
+    const char *arg;                    // Constant or substring argument, if the operation takes one
+    size_t arg_len;
+    bool *results;                      // Per-string results for the predicate operations
+    uint64_t *hashes;                   // Per-string results for HASH
+    uint64_t seed;                      // Seed for HASH
+    size_t begin, end;                  // Slice of the batch handled by this task
+    size_t found;                       // Number of strings in the slice for which the result is true
+} _BatchTask;
+
+/* =========================================================================================================================
+ * _batch_get - Returns string i of the batch and stores its length in *len. NULL for a NULL array entry
+ * ========================================================================================================================*/
+
+static inline char *_batch_get(const StrBatch *batch, size_t i, size_t *len) {
+    if (batch->strs) {
+        char *s = batch->strs[i];
+        *len = s ? strlen(s) : 0;
+        return s;
+    }
+    *len = batch->offsets[i+1] - batch->offsets[i];
+    return batch->blob + batch->offsets[i];
+}
+
+/* =========================================================================================================================
+ * _batch_equals_packed - EQUALS / CASE_EQUALS over a packed slice, four strings per step. The lengths come straight from
+ * the offsets, two per vector (the 64-bit compare is built from 32-bit ones, SSE2 has none), so four strings of the wrong
+ * length are rejected with two compares and a single branch. A candidate is then checked with one masked compare against
+ * the preloaded (and for CASE_EQUALS folded) constant while the constant fits a vector and the 16 byte load stays inside
+ * the blob, and with memcmp / strnCaseCmp otherwise
+ * ========================================================================================================================*/
+
+#if defined(__SSE2__) && SIZE_MAX == UINT64_MAX
+static inline bool _batch_equals_at(_BatchTask *t, size_t j, __m128i constant, unsigned int want) {
+    const char *s = t->batch->blob + t->batch->offsets[j], *end = t->batch->blob + t->batch->offsets[t->batch->count];
+    const size_t m = t->arg_len;
+    if (m <= 16 && (size_t)(end - s) >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)s);
+        if (t->op == CASE_EQUALS) v = _simd_lc(v);
+        return ((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, constant)) & want) == want;
+    }
+    return t->op == CASE_EQUALS ? !m || !strnCaseCmp(s, t->arg, (long int)m) : !memcmp(s, t->arg, m);
+}
+
+static void _batch_equals_packed(_BatchTask *t) {
+    const size_t *offsets = t->batch->offsets, m = t->arg_len;
+    char padded[16] = {0};
+    memcpy(padded, t->arg, m < 16 ? m : 16);
+    __m128i constant = _mm_loadu_si128((const __m128i *)padded), vm = _mm_set1_epi64x((long long)m);
+    if (t->op == CASE_EQUALS) constant = _simd_lc(constant);
+    const unsigned int want = m < 16 ? (1u << m) - 1 : 0xFFFF;
+
+    size_t i = t->begin;
+    for (; i + 4 <= t->end; i += 4) {
+        __m128i len0 = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)&offsets[i+1]), _mm_loadu_si128((const __m128i *)&offsets[i]));
+        __m128i len1 = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)&offsets[i+3]), _mm_loadu_si128((const __m128i *)&offsets[i+2]));
+        __m128i eq0 = _mm_cmpeq_epi32(len0, vm), eq1 = _mm_cmpeq_epi32(len1, vm);
+        eq0 = _mm_and_si128(eq0, _mm_shuffle_epi32(eq0, _MM_SHUFFLE(2, 3, 0, 1)));
+        eq1 = _mm_and_si128(eq1, _mm_shuffle_epi32(eq1, _MM_SHUFFLE(2, 3, 0, 1)));
+        unsigned int lanes = (unsigned int)_mm_movemask_pd(_mm_castsi128_pd(eq0)) | (unsigned int)_mm_movemask_pd(_mm_castsi128_pd(eq1)) << 2;
+        if (t->results) t->results[i] = t->results[i+1] = t->results[i+2] = t->results[i+3] = false;
+        for (; lanes; lanes &= lanes - 1) {
+            size_t j = i + (size_t)__builtin_ctz(lanes);
+            bool r = _batch_equals_at(t, j, constant, want);
+            if (t->results) t->results[j] = r;
+            t->found += r;
+        }
+    }
+    for (; i < t->end; ++i) {
+        bool r = offsets[i+1] - offsets[i] == m && _batch_equals_at(t, i, constant, want);
+        if (t->results) t->results[i] = r;
+        t->found += r;
+    }
+}
+#endif
+
+/* =========================================================================================================================
+ * _batch_range - Applies the task's operation to its slice of the batch
+ * ========================================================================================================================*/
+
+static void _batch_range(_BatchTask *t) {
+    const StrBatch *batch = t->batch;
+
+    // Packed case folding touches one contiguous region, so fold it in a single vectorized pass
+    if ((t->op == LWR || t->op == UPR) && !batch->strs) {
+        size_t first = batch->offsets[t->begin], n = batch->offsets[t->end] - first;
+        t->op == LWR ? strnLwr(batch->blob + first, n) : strnUpr(batch->blob + first, n);
+        t->found = t->end - t->begin;
+        return;
+    }
+#if defined(__SSE2__) && SIZE_MAX == UINT64_MAX
+    if ((t->op == EQUALS || t->op == CASE_EQUALS) && !batch->strs) {
+        _batch_equals_packed(t);
+        return;
+    }
+#endif
+
+    for (size_t i = t->begin, len; i < t->end; ++i) {
+        char *s = _batch_get(batch, i, &len);
+        bool r = false;
+        if (s) switch (t->op) {
+            case LWR:           strLwr(s), r = true; break;
+            case UPR:           strUpr(s), r = true; break;
+            case HASH:          t->hashes[i] = strHashN(s, len, t->seed); break;
+            case EQUALS:        r = len == t->arg_len && !memcmp(s, t->arg, len); break;
+            case CASE_EQUALS:   r = len == t->arg_len && (!len || !strnCaseCmp(s, t->arg, (long int)len)); break;
+            case CONTAINS:      r = memmem(s, len, t->arg, t->arg_len) != NULL; break;
+            case HAS_DUPS:      r = strnHasDups(s, len); break;
+            case CASE_HAS_DUPS: r = strnCaseHasDups(s, len); break;
+        } else if (t->op == HASH) {
+            t->hashes[i] = 0;
+        }
+        if (t->results) t->results[i] = r;
+        t->found += r;
+    }
+}
+
+static void *_batch_worker(void *arg) {
+    _batch_range(arg);
+    return NULL;
+}
+
+/* =========================================================================================================================
+ * _batch_run - Splits the batch into equal slices, one per thread, runs them and sums the per-slice counts
+ * ========================================================================================================================*/
+
+static size_t _batch_run(const StrBatch *batch, _BatchOp op, const char *arg, bool *results, uint64_t *hashes, uint64_t seed,
+                         unsigned int threads) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (!threads) threads = online > 0 ? (unsigned int)online : 1;
+    if (threads > batch->count / STRBATCH_MIN_PER_THREAD) threads = (unsigned int)(batch->count / STRBATCH_MIN_PER_THREAD);
+    if (!threads) threads = 1;
+
+    _BatchTask tasks[threads];
+    pthread_t workers[threads];
+    size_t per = batch->count / threads, extra = batch->count % threads, begin = 0, found = 0;
+    for (unsigned int i = 0; i < threads; ++i) {
+        size_t end = begin + per + (i < extra);
+        tasks[i] = (_BatchTask){ batch, op, arg, arg ? strlen(arg) : 0, results, hashes, seed, begin, end, 0 };
+        begin = end;
+    }
+
+    // Slice 0 runs on the calling thread. Any slice whose thread couldn't be started also runs here
+    bool started[threads];
+    for (unsigned int i = 1; i < threads; ++i) started[i] = !pthread_create(&workers[i], NULL, _batch_worker, &tasks[i]);
+    _batch_range(&tasks[0]);
+    for (unsigned int i = 1; i < threads; ++i) {
+        if (started[i]) pthread_join(workers[i], NULL);
+        else _batch_range(&tasks[i]);
+    }
+    for (unsigned int i = 0; i < threads; ++i) found += tasks[i].found;
+    return found;
+}
+
+/* *************************************************************************************************************************
+ * strBatchLwr / strBatchUpr - Converts every string in the batch to lowercase / uppercase. Returns the number of strings
+ * converted (NULL array entries are skipped)
+ * *************************************************************************************************************************/
+
+size_t strBatchLwr(const StrBatch *batch, unsigned int threads) {
+    return _batch_run(batch, LWR, NULL, NULL, NULL, 0, threads);
+}
+
+size_t strBatchUpr(const StrBatch *batch, unsigned int threads) {
+    return _batch_run(batch, UPR, NULL, NULL, NULL, 0, threads);
+}
+
+/* *************************************************************************************************************************
+ * strBatchHash - Stores strHashN of each string with the given seed in hashes[i]. NULL array entries hash to 0
+ * *************************************************************************************************************************/
+
+void strBatchHash(const StrBatch *batch, uint64_t *hashes, uint64_t seed, unsigned int threads) {
+    _batch_run(batch, HASH, NULL, NULL, hashes, seed, threads);
+}
+
+/* *************************************************************************************************************************
+ * strBatchEquals / strBatchCaseEquals - Compares each string to 'constant'. Strings of a different length are rejected
+ * without touching their characters
+ * *************************************************************************************************************************/
+
+size_t strBatchEquals(const StrBatch *batch, const char *constant, bool *results, unsigned int threads) {
+    return _batch_run(batch, EQUALS, constant, results, NULL, 0, threads);
+}
+
+size_t strBatchCaseEquals(const StrBatch *batch, const char *constant, bool *results, unsigned int threads) {
+    return _batch_run(batch, CASE_EQUALS, constant, results, NULL, 0, threads);
+}
+
+/* *************************************************************************************************************************
+ * strBatchContains - Determines whether each string contains 'sub'
+ * *************************************************************************************************************************/
+
+size_t strBatchContains(const StrBatch *batch, const char *sub, bool *results, unsigned int threads) {
+    return _batch_run(batch, CONTAINS, sub, results, NULL, 0, threads);
+}
+
+/* *************************************************************************************************************************
+ * strBatchHasDups / strBatchCaseHasDups - Determines whether each string has duplicate characters
+ * *************************************************************************************************************************/
+
+size_t strBatchHasDups(const StrBatch *batch, bool *results, unsigned int threads) {
+    return _batch_run(batch, HAS_DUPS, NULL, results, NULL, 0, threads);
+}
+
+size_t strBatchCaseHasDups(const StrBatch *batch, bool *results, unsigned int threads) {
+    return _batch_run(batch, CASE_HAS_DUPS, NULL, results, NULL, 0, threads);
+}
+
+/* *************************************************************************************************************************/
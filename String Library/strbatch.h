@@ -0,0 +1,47 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strbatch.h                                                                                                              *
+ *                                                                                                                         *
+ * Batch string operations. Each function applies one operation to every string in a StrBatch with a single call, so the   *
+ * per-call and per-string setup is paid once. A batch is either an array of NUL terminated strings or a packed layout     *
+ * (one blob plus offsets), which lets case folding run as one vectorized pass over all of the strings and equality checks *
+ * reject several strings per instruction by length. Work can optionally be split across threads.                          *
+ * ======================================================================================================================= */
+
+#ifndef strbatch_h
+#define strbatch_h
+
+#include <stdint.h>
+#include "strings.h"
+
+#define STRBATCH_MIN_PER_THREAD 4096    // Batches are only split so that each thread gets at least this many strings
+
+/* *************************************************** TYPEDEFS ************************************************************/
+typedef struct {                        /* Struct describing a batch of strings in either layout */
+    char **strs;                        // Array layout: NUL terminated strings (NULL entries are allowed and skipped)
+    char *blob;                         // Packed layout: the strings' characters back to back (need not be NUL terminated)
+    const size_t *offsets;              // Packed layout: count + 1 offsets, string i is blob[offsets[i], offsets[i+1])
+    size_t count;                       // Number of strings
+} StrBatch;
+
+/* *************************************************************************************************************************/
+#define strBatchArray_(array, n) ((StrBatch){ .strs = (array), .count = (n) })
+#define strBatchPacked_(data, offs, n) ((StrBatch){ .blob = (data), .offsets = (offs), .count = (n) })
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions. For every function, threads = 0 uses one thread per online processor and threads = 1 runs on the
+// calling thread only. Functions returning size_t return the number of strings for which the result is true
+
+extern size_t strBatchLwr(const StrBatch *batch, unsigned int threads);
+extern size_t strBatchUpr(const StrBatch *batch, unsigned int threads);
+extern void strBatchHash(const StrBatch *batch, uint64_t *hashes, uint64_t seed, unsigned int threads);
+extern size_t strBatchEquals(const StrBatch *batch, const char *constant, bool *results, unsigned int threads);
+extern size_t strBatchCaseEquals(const StrBatch *batch, const char *constant, bool *results, unsigned int threads);
+extern size_t strBatchContains(const StrBatch *batch, const char *sub, bool *results, unsigned int threads);
+extern size_t strBatchHasDups(const StrBatch *batch, bool *results, unsigned int threads);
+extern size_t strBatchCaseHasDups(const StrBatch *batch, bool *results, unsigned int threads);
+/* *************************************************************************************************************************/
+
+#endif /* strbatch_h */
@@ -0,0 +1,222 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strbuilder.c                                                                                                            *
+ * ======================================================================================================================= */
+
+#define _GNU_SOURCE                     // strnlen
+#include <string.h>
+#include "strbuilder.h"
+
+/* =========================================================================================================================
+ * _sb_grow - Grows the builder so at least 'needed' characters fit. Capacity is doubled until large enough, which keeps
+ * the total copying done by a sequence of appends linear in the final length
+ * ========================================================================================================================*/
+
+static inline bool _sb_grow(StrBuilder *sb, size_t needed) {
+    if (needed <= sb->cap && sb->data) return true;
+    size_t cap = sb->cap < STRBUILDER_MIN_CAP ? STRBUILDER_MIN_CAP : sb->cap;
+    while (cap < needed) {
+        if (cap > ((size_t)-1 >> 1)) { cap = needed; break; }     // Doubling would overflow, grow to exactly what's needed
+        cap *= 2;
+    }
+    if (cap == (size_t)-1) return false;                          // No room left for the NUL terminator
+    char *data = realloc(sb->data, cap + 1);
+    if (!data) return false;                                      // Builder is left untouched on failure
+    if (!sb->data) *data = '\0';
+    sb->data = data, sb->cap = cap;
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderInit - Initializes an empty builder with room for 'cap' characters. A cap of 0 defers allocation until the
+ * first append. Returns false if the allocation fails
+ * *************************************************************************************************************************/
+
+bool strBuilderInit(StrBuilder *sb, size_t cap) {
+    strBuilderInit_(sb);
+    return cap ? _sb_grow(sb, cap) : true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderFree - Frees the builder's buffer and resets it to the empty state
+ * *************************************************************************************************************************/
+
+void strBuilderFree(StrBuilder *sb) {
+    free(sb->data);
+    strBuilderInit_(sb);
+}
+
+/* *************************************************************************************************************************
+ * strBuilderClear - Empties the builder but keeps its buffer for reuse
+ * *************************************************************************************************************************/
+
+void strBuilderClear(StrBuilder *sb) {
+    strBuilderClear_(sb);
+}
+
+/* *************************************************************************************************************************
+ * strBuilderReserve - Ensures the builder can hold at least 'cap' characters without reallocating
+ * *************************************************************************************************************************/
+
+bool strBuilderReserve(StrBuilder *sb, size_t cap) {
+    return _sb_grow(sb, cap);
+}
+
+/* *************************************************************************************************************************
+ * strBuilderShrink - Shrinks the buffer to fit the current length exactly
+ * *************************************************************************************************************************/
+
+bool strBuilderShrink(StrBuilder *sb) {
+    if (!sb->data || sb->cap == sb->len) return true;
+    char *data = realloc(sb->data, sb->len + 1);
+    if (!data) return false;
+    sb->data = data, sb->cap = sb->len;
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderAppendN - Appends the first n characters of 'source'. 'source' may point into the builder's own buffer
+ * *************************************************************************************************************************/
+
+bool strBuilderAppendN(StrBuilder *sb, const char *source, size_t n) {
+    if (n > (size_t)-1 - sb->len) return false;
+    ptrdiff_t self = sb->data && source >= sb->data && source <= sb->data + sb->len ? source - sb->data : -1;
+    if (!_sb_grow(sb, sb->len + n)) return false;
+    if (self >= 0) source = sb->data + self;                     // Appending from our own buffer, which may have moved
+    memmove(sb->data + sb->len, source, n);
+    sb->data[sb->len += n] = '\0';
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderAppend - Appends 'source'. Replaces strCat for destinations whose size isn't known up front
+ * *************************************************************************************************************************/
+
+bool strBuilderAppend(StrBuilder *sb, const char *source) {
+    return strBuilderAppendN(sb, source, strlen(source));
+}
+
+/* *************************************************************************************************************************
+ * strBuilderCaseAppend - Appends 'source' converted to lowercase. Replaces strCaseCat. 'source' may point into the
+ * builder's own buffer
+ * *************************************************************************************************************************/
+
+bool strBuilderCaseAppend(StrBuilder *sb, const char *source) {
+    size_t n = strlen(source);
+    if (n > (size_t)-1 - sb->len) return false;
+    ptrdiff_t self = sb->data && source >= sb->data && source <= sb->data + sb->len ? source - sb->data : -1;
+    if (!_sb_grow(sb, sb->len + n)) return false;
+    if (self >= 0) source = sb->data + self;                     // Appending from our own buffer, which may have moved
+    strnCaseCpy(sb->data + sb->len, source, n);
+    sb->data[sb->len += n] = '\0';
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderAppendChar - Appends a single character. Replaces strCharCat
+ * *************************************************************************************************************************/
+
+bool strBuilderAppendChar(StrBuilder *sb, char ch) {
+    if (!_sb_grow(sb, sb->len + 1)) return false;
+    sb->data[sb->len++] = ch;
+    sb->data[sb->len] = '\0';
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderCaseAppendChar - Appends a single character converted to lowercase. Replaces strCaseCharCat
+ * *************************************************************************************************************************/
+
+bool strBuilderCaseAppendChar(StrBuilder *sb, char ch) {
+    return strBuilderAppendChar(sb, lc(ch));
+}
+
+/* *************************************************************************************************************************
+ * strBuilderInsert - Inserts 'source' at index 'idx' (idx <= length). Replaces strInsert. The tail is shifted with a
+ * single overlapping move rather than one character at a time
+ * *************************************************************************************************************************/
+
+bool strBuilderInsert(StrBuilder *sb, size_t idx, const char *source) {
+    size_t n = strlen(source);
+    if (idx > sb->len || n > (size_t)-1 - sb->len) return false;
+    ptrdiff_t self = sb->data && source >= sb->data && source <= sb->data + sb->len ? source - sb->data : -1;
+    if (!_sb_grow(sb, sb->len + n)) return false;
+    char *at = sb->data + idx;
+    memmove(at + n, at, sb->len - idx + 1);                       // Shift the tail (and its NUL) back by n
+    if (self < 0) {
+        memcpy(at, source, n);
+    } else {                                                      // Source lives in our buffer: it may straddle the gap
+        size_t before = (size_t)self < idx ? (self + n <= idx ? n : idx - self) : 0;
+        memmove(at, sb->data + self, before);
+        memmove(at + before, sb->data + (self + before < idx ? self + before : self + before + n), n - before);
+    }
+    sb->len += n;
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderVFormat - Appends printf-style formatted output
+ * *************************************************************************************************************************/
+
+bool strBuilderVFormat(StrBuilder *sb, const char *format, va_list args) {
+    va_list retry;
+    va_copy(retry, args);
+
+    // Try to format into the space already available. vsnprintf reports the full length even when it doesn't fit
+    size_t room = sb->data ? sb->cap - sb->len + 1 : 0;
+    int n = vsnprintf(sb->data ? sb->data + sb->len : NULL, room, format, args);
+    if (n < 0) { va_end(retry); return false; }
+
+    // Didn't fit: grow once to the exact size needed and format again
+    if ((size_t)n >= room) {
+        if ((size_t)n > (size_t)-1 - sb->len || !_sb_grow(sb, sb->len + n)) {
+            if (sb->data) sb->data[sb->len] = '\0';               // Undo any partial output
+            va_end(retry);
+            return false;
+        }
+        vsnprintf(sb->data + sb->len, sb->cap - sb->len + 1, format, retry);
+    }
+    va_end(retry);
+    sb->len += n;
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderFormat - Appends printf-style formatted output
+ * *************************************************************************************************************************/
+
+bool strBuilderFormat(StrBuilder *sb, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    bool ret = strBuilderVFormat(sb, format, args);
+    va_end(args);
+    return ret;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderAdopt - Takes ownership of a malloc'd, NUL terminated buffer with room for 'cap' characters (plus the NUL)
+ * without copying it. Any buffer the builder already held is freed
+ * *************************************************************************************************************************/
+
+bool strBuilderAdopt(StrBuilder *sb, char *buffer, size_t cap) {
+    if (!buffer) return false;
+    size_t n = strnlen(buffer, cap + 1);
+    if (n > cap) return false;                                    // Not terminated within its capacity
+    free(sb->data);
+    sb->data = buffer, sb->len = n, sb->cap = cap;
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strBuilderRelease - Hands the buffer to the caller without copying and resets the builder. The caller frees the
+ * returned string. Never returns NULL unless allocation of an empty string fails
+ * *************************************************************************************************************************/
+
+char *strBuilderRelease(StrBuilder *sb, size_t *len) {
+    char *s = sb->data ? sb->data : calloc(1, 1);
+    if (len) *len = sb->len;
+    strBuilderInit_(sb);
+    return s;
+}
+
+/* *************************************************************************************************************************/
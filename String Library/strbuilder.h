@@ -0,0 +1,66 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strbuilder.h                                                                                                            *
+ *                                                                                                                         *
+ * Growable string builder. Unlike strCat/strInsert/strCharCat, which write into a destination of unknown size, a          *
+ * StrBuilder tracks both the length and the capacity of its buffer and grows it geometrically, so repeated appends are    *
+ * amortized O(1) and can never overrun. The buffer is always NUL terminated and can be adopted or released without a copy.*
+ * ======================================================================================================================= */
+
+#ifndef strbuilder_h
+#define strbuilder_h
+
+#include <stdarg.h>
+#include "strings.h"
+
+#define STRBUILDER_MIN_CAP 16
+
+/* *************************************************** TYPEDEFS ************************************************************/
+typedef struct {                        /* Struct for a growable, NUL terminated string */
+    char *data;                         // Heap buffer holding the string (NULL until the first allocation)
+    size_t len;                         // Number of characters currently stored (excluding the NUL)
+    size_t cap;                         // Number of characters that fit without reallocating (excluding the NUL)
+} StrBuilder;
+
+/* *************************************************************************************************************************/
+#define strBuilderInit_(sb) ({ (sb)->data = NULL, (sb)->len = (sb)->cap = 0; (sb); })
+#define strBuilderStr_(sb) ((sb)->data ? (sb)->data : "")
+#define strBuilderLen_(sb) ((sb)->len)
+#define strBuilderClear_(sb) ({ if ((sb)->data) *(sb)->data = '\0'; (sb)->len = 0; (sb); })
+
+extern bool strBuilderInit(StrBuilder *sb, size_t cap);
+extern void strBuilderFree(StrBuilder *sb);
+extern void strBuilderClear(StrBuilder *sb);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern bool strBuilderReserve(StrBuilder *sb, size_t cap);
+extern bool strBuilderShrink(StrBuilder *sb);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern bool strBuilderAppend(StrBuilder *sb, const char *source);
+extern bool strBuilderAppendN(StrBuilder *sb, const char *source, size_t n);
+extern bool strBuilderCaseAppend(StrBuilder *sb, const char *source);
+extern bool strBuilderAppendChar(StrBuilder *sb, char ch);
+extern bool strBuilderCaseAppendChar(StrBuilder *sb, char ch);
+extern bool strBuilderInsert(StrBuilder *sb, size_t idx, const char *source);
+extern bool strBuilderFormat(StrBuilder *sb, const char *format, ...) __attribute__((format(printf, 2, 3)));
+extern bool strBuilderVFormat(StrBuilder *sb, const char *format, va_list args);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern bool strBuilderAdopt(StrBuilder *sb, char *buffer, size_t cap);
+extern char *strBuilderRelease(StrBuilder *sb, size_t *len);
+/* *************************************************************************************************************************/
+
+#endif /* strbuilder_h */
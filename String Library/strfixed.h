@@ -0,0 +1,101 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strfixed.h                                                                                                              *
+ *                                                                                                                         *
+ * Substring search specialized for needles that are string literals (header names, keywords). The search kernel is        *
+ * forced inline, so with a literal needle its length, first and last characters and the comparison of the middle become   *
+ * compile time constants: the compiler unrolls the compare and no needle preprocessing is left at run time. The scan      *
+ * tests 16 positions at once by matching the needle's first and last characters (SSE2) and only verifies the middle of    *
+ * the candidates that pass both. Header only: the macros must see the literal.                                            *
+ *                                                                                                                         *
+ *     STRFIXED_DEFINE(findHost, "Host:")              // char *findHost(const char *str), char *findHostN(str, n)         *
+ *     char *h = strFixedStr_(line, "Content-Length:");                                                                    *
+ * ======================================================================================================================= */
+
+#ifndef strfixed_h
+#define strfixed_h
+
+#include <string.h>
+#include "strings.h"
+#include "strsimd.h"                    // _simd_lc
+
+/* =========================================================================================================================
+ * _strfixed_find - Returns the first occurrence of needle[0, m) in str[0, n), or NULL. Meant to be inlined with constant
+ * needle, m and fold: every branch on them folds away
+ * ========================================================================================================================*/
+
+static inline __attribute__((always_inline)) bool _strfixed_eq(const char *s, const char *needle, size_t m, bool fold) {
+    if (!fold) return !memcmp(s, needle, m);
+    for (size_t k = 0; k < m; ++k) if (lc(s[k]) != lc(needle[k])) return false;
+    return true;
+}
+
+static inline __attribute__((always_inline)) const char *_strfixed_find(const char *str, size_t n, const char *needle,
+                                                                       size_t m, bool fold) {
+    if (!m) return str;
+    if (n < m) return NULL;
+    if (m == 1 && !fold) return memchr(str, needle[0], n);
+
+    const char first = fold ? lc(needle[0]) : needle[0], last = fold ? lc(needle[m-1]) : needle[m-1];
+    const size_t middle = m > 2 ? m - 2 : 0;                   // Characters left to verify once first and last match
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i vfirst = _mm_set1_epi8(first), vlast = _mm_set1_epi8(last);
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)&str[i]), b = _mm_loadu_si128((const __m128i *)&str[i + m - 1]);
+        if (fold) a = _simd_lc(a), b = _simd_lc(b);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, vfirst), _mm_cmpeq_epi8(b, vlast)));
+        for (; mask; mask &= mask - 1) {
+            size_t j = i + (size_t)__builtin_ctz(mask);
+            if (_strfixed_eq(&str[j + 1], &needle[1], middle, fold)) return &str[j];
+        }
+    }
+#endif
+    for (; i + m <= n; ++i) {
+        if ((fold ? lc(str[i]) : str[i]) != first || (fold ? lc(str[i + m - 1]) : str[i + m - 1]) != last) continue;
+        if (_strfixed_eq(&str[i + 1], &needle[1], middle, fold)) return &str[i];
+    }
+    return NULL;
+}
+
+/* *************************************************************************************************************************/
+// lit must be a string literal (pasting it between "" rejects anything else at compile time). The N versions search the
+// first n characters of str, which need not be NUL terminated
+
+#define strFixedStr_(str, lit) ({                                                                   \
+    const char *s_ = (str);                                                                         \
+    (char *)_strfixed_find(s_, strlen(s_), "" lit "", sizeof(lit) - 1, false);                      \
+})
+
+#define strFixedCaseStr_(str, lit) ({                                                               \
+    const char *s_ = (str);                                                                         \
+    (char *)_strfixed_find(s_, strlen(s_), "" lit "", sizeof(lit) - 1, true);                       \
+})
+
+#define strnFixedStr_(str, n, lit) ((char *)_strfixed_find((str), (n), "" lit "", sizeof(lit) - 1, false))
+#define strnFixedCaseStr_(str, n, lit) ((char *)_strfixed_find((str), (n), "" lit "", sizeof(lit) - 1, true))
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// Defines a named matcher pair for a literal: name(str) searches a NUL terminated string, nameN(str, n) the first n
+// characters. Use at file scope
+
+#define STRFIXED_DEFINE(name, lit)                                                                  \
+    static inline char *name##N(const char *str, size_t n) {                                        \
+        return (char *)_strfixed_find(str, n, "" lit "", sizeof(lit) - 1, false);                   \
+    }                                                                                               \
+    static inline char *name(const char *str) {                                                     \
+        return name##N(str, strlen(str));                                                           \
+    }
+
+#define STRFIXED_CASE_DEFINE(name, lit)                                                             \
+    static inline char *name##N(const char *str, size_t n) {                                        \
+        return (char *)_strfixed_find(str, n, "" lit "", sizeof(lit) - 1, true);                    \
+    }                                                                                               \
+    static inline char *name(const char *str) {                                                     \
+        return name##N(str, strlen(str));                                                           \
+    }
+/* *************************************************************************************************************************/
+
+#endif /* strfixed_h */
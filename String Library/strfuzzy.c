@@ -0,0 +1,351 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strfuzzy.c                                                                                                              *
+ * ======================================================================================================================= */
+
+#include <string.h>
+#include "strfuzzy.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#define _BLOCK 64                                               // Pattern characters per bit vector
+#define _BATCH_MAX_QUERY 16                                     // Longest query the 16-bit lane batch kernel can take
+
+/* =========================================================================================================================
+ * _build_peq - Builds the match masks of pattern p: bit i of peq[b * 256 + c] is set if p[b * 64 + i] matches c. With
+ * fold, letters match both cases, so the text never has to be folded
+ * ========================================================================================================================*/
+
+static void _build_peq(uint64_t *peq, const unsigned char *p, size_t m, bool fold) {
+    memset(peq, 0, (m + _BLOCK - 1) / _BLOCK * EXTENDED_ASCII_RANGE * sizeof(uint64_t));
+    for (size_t i = 0; i < m; ++i) {
+        uint64_t *block = peq + i / _BLOCK * EXTENDED_ASCII_RANGE, bit = (uint64_t)1 << (i % _BLOCK);
+        unsigned char c = p[i];
+        block[c] |= bit;
+        if (fold && lc(c) != uc(c)) block[lc(c)] |= bit, block[uc(c)] |= bit;
+    }
+}
+
+/* =========================================================================================================================
+ * _distance_word - Edit distance between a pattern of 1-64 characters (given by its match masks) and text t[0, n).
+ * Hyyrö's formulation of Myers' algorithm: vp / vn mark the rows where the current column increases / decreases, d0 the
+ * rows where the diagonal step is free. The Damerau variant also makes a diagonal free where the previous two characters
+ * form a transposition
+ * ========================================================================================================================*/
+
+static size_t _distance_word(const uint64_t *peq, size_t m, const unsigned char *t, size_t n, bool damerau) {
+    uint64_t vp = ~(uint64_t)0, vn = 0, d0 = 0, prev = 0, last = (uint64_t)1 << (m - 1);
+    size_t dist = m;
+    for (size_t j = 0; j < n; ++j) {
+        uint64_t eq = peq[t[j]], tr = damerau ? (((~d0) & eq) << 1) & prev : 0;
+        d0 = (((eq & vp) + vp) ^ vp) | eq | vn | tr;
+        uint64_t hp = vn | ~(d0 | vp), hn = d0 & vp;
+        dist += (hp & last) != 0;
+        dist -= (hn & last) != 0;
+        hp = (hp << 1) | 1, hn <<= 1;
+        vp = hn | ~(d0 | hp), vn = hp & d0;
+        prev = eq;
+    }
+    return dist;
+}
+
+/* =========================================================================================================================
+ * _advance_block - Advances one 64 row block of a column by one text character. hin is the change (-1, 0 or +1) along
+ * the block's top edge; the change along its bottom edge is returned for the block below. *ph / *mh receive the rows of
+ * the block whose value went up / down, for reading the score at the pattern's last row
+ * ========================================================================================================================*/
+
+static inline int _advance_block(uint64_t *pv, uint64_t *mv, uint64_t eq, int hin, uint64_t *ph, uint64_t *mh) {
+    uint64_t hneg = hin < 0, hpos = hin > 0, xv = eq | *mv;
+    eq |= hneg;
+    uint64_t xh = (((eq & *pv) + *pv) ^ *pv) | eq;
+    uint64_t p = *mv | ~(xh | *pv), m = *pv & xh;
+    *ph = p, *mh = m;
+    int hout = (int)(p >> (_BLOCK - 1)) - (int)(m >> (_BLOCK - 1));
+    p = (p << 1) | hpos, m = (m << 1) | hneg;
+    *pv = m | ~(xv | p), *mv = p & xv;
+    return hout;
+}
+
+/* =========================================================================================================================
+ * _scan - Runs the blocked Myers algorithm for a pattern of m > 0 characters over t[0, n). With search unset the top row
+ * grows by one per character (plain edit distance, returned); with search set it stays 0, so a match may start anywhere,
+ * and the scan stops at the first end position within k edits, moving on while the distance keeps dropping. *end then
+ * gets the end of the match. Returns SIZE_MAX if a search finds nothing or memory runs out
+ * ========================================================================================================================*/
+
+static size_t _scan(const uint64_t *peq, size_t m, const unsigned char *t, size_t n, bool search, size_t k, size_t *end) {
+    size_t blocks = (m + _BLOCK - 1) / _BLOCK, score = m, best = SIZE_MAX;
+    unsigned int lastbit = (unsigned int)((m - 1) % _BLOCK);
+    uint64_t local[2], *pv = blocks > 1 ? malloc(2 * blocks * sizeof(uint64_t)) : local, *mv, ph = 0, mh = 0;
+    if (!pv) return SIZE_MAX;
+    mv = pv + blocks;
+    for (size_t b = 0; b < blocks; ++b) pv[b] = ~(uint64_t)0, mv[b] = 0;
+
+    for (size_t j = 0; j < n; ++j) {
+        int h = search ? 0 : 1;
+        for (size_t b = 0; b < blocks; ++b) h = _advance_block(&pv[b], &mv[b], peq[b * EXTENDED_ASCII_RANGE + t[j]], h, &ph, &mh);
+        score += (ph >> lastbit) & 1;
+        score -= (mh >> lastbit) & 1;
+        if (!search) continue;
+        if (best != SIZE_MAX) {
+            if (score >= best) break;
+            best = score, *end = j + 1;
+        } else if (score <= k) {
+            best = score, *end = j + 1;
+        }
+    }
+    if (pv != local) free(pv);
+    return search ? best : score;
+}
+
+/* =========================================================================================================================
+ * _osa_dp - Damerau (optimal string alignment) distance by dynamic programming, three rows. Used for patterns longer than
+ * one word, where the bit-parallel transposition trick doesn't carry across blocks
+ * ========================================================================================================================*/
+
+static size_t _osa_dp(const unsigned char *p, size_t m, const unsigned char *t, size_t n, bool fold) {
+    size_t *rows = malloc(3 * (m + 1) * sizeof(size_t));
+    if (!rows) return SIZE_MAX;
+    size_t *two = rows, *one = rows + m + 1, *cur = rows + 2 * (m + 1);
+    for (size_t i = 0; i <= m; ++i) one[i] = i;
+    for (size_t j = 1; j <= n; ++j) {
+        cur[0] = j;
+        for (size_t i = 1; i <= m; ++i) {
+            bool same = fold ? lc(p[i-1]) == lc(t[j-1]) : p[i-1] == t[j-1];
+            size_t d = one[i-1] + !same;
+            if (one[i] + 1 < d) d = one[i] + 1;
+            if (cur[i-1] + 1 < d) d = cur[i-1] + 1;
+            if (i > 1 && j > 1 && (fold ? lc(p[i-1]) == lc(t[j-2]) && lc(p[i-2]) == lc(t[j-1])
+                                        : p[i-1] == t[j-2] && p[i-2] == t[j-1]) && two[i-2] + 1 < d) d = two[i-2] + 1;
+            cur[i] = d;
+        }
+        size_t *tmp = two;
+        two = one, one = cur, cur = tmp;
+    }
+    size_t dist = one[m];
+    free(rows);
+    return dist;
+}
+
+/* =========================================================================================================================
+ * _distance - Edit distance between s1 and s2. The shorter string becomes the pattern, so strings up to 64 characters
+ * long (against text of any length) take the single word path
+ * ========================================================================================================================*/
+
+static size_t _distance(const char *s1, const char *s2, bool fold, bool damerau) {
+    const unsigned char *p = (const unsigned char *)s1, *t = (const unsigned char *)s2;
+    size_t m = strlen(s1), n = strlen(s2);
+    if (m > n) {
+        const unsigned char *tmp = p;
+        p = t, t = tmp;
+        size_t len = m;
+        m = n, n = len;
+    }
+    if (!m) return n;
+    if (damerau && m > _BLOCK) return _osa_dp(p, m, t, n, fold);
+
+    uint64_t local[EXTENDED_ASCII_RANGE];
+    uint64_t *peq = m > _BLOCK ? malloc((m + _BLOCK - 1) / _BLOCK * EXTENDED_ASCII_RANGE * sizeof(uint64_t)) : local;
+    if (!peq) return SIZE_MAX;
+    _build_peq(peq, p, m, fold);
+    size_t dist = m > _BLOCK ? _scan(peq, m, t, n, false, 0, NULL) : _distance_word(peq, m, t, n, damerau);
+    if (peq != local) free(peq);
+    return dist;
+}
+
+/* *************************************************************************************************************************
+ * strLevenshtein / strCaseLevenshtein - Levenshtein distance between s1 and s2. SIZE_MAX if memory runs out (only
+ * possible when both strings are longer than 64 characters)
+ * *************************************************************************************************************************/
+
+size_t strLevenshtein(const char *s1, const char *s2) {
+    return _distance(s1, s2, false, false);
+}
+
+size_t strCaseLevenshtein(const char *s1, const char *s2) {
+    return _distance(s1, s2, true, false);
+}
+
+/* *************************************************************************************************************************
+ * strDamerau / strCaseDamerau - Damerau distance between s1 and s2. SIZE_MAX if memory runs out
+ * *************************************************************************************************************************/
+
+size_t strDamerau(const char *s1, const char *s2) {
+    return _distance(s1, s2, false, true);
+}
+
+size_t strCaseDamerau(const char *s1, const char *s2) {
+    return _distance(s1, s2, true, true);
+}
+
+/* =========================================================================================================================
+ * _match_start - Given that a match of p[0, m) ends at t[end], finds where it starts: the suffix of t[0, end), at most
+ * m + k long, closest to p in edit distance (ties go to the length closest to m). Dynamic programming over that window
+ * only, so it costs O(m (m + k)) once per search
+ * ========================================================================================================================*/
+
+static size_t _match_start(const unsigned char *p, size_t m, const unsigned char *t, size_t end, size_t k, bool fold) {
+    size_t w = end < m + k ? end : m + k, *row = malloc(2 * (w + 1) * sizeof(size_t));
+    if (!row) return SIZE_MAX;
+    size_t *prev = row, *cur = row + w + 1;
+    for (size_t l = 0; l <= w; ++l) prev[l] = l;
+    for (size_t i = 1; i <= m; ++i) {                           // Pattern and text both read backwards from the end
+        cur[0] = i;
+        for (size_t l = 1; l <= w; ++l) {
+            unsigned char a = p[m-i], b = t[end-l];
+            size_t d = prev[l-1] + !(fold ? lc(a) == lc(b) : a == b);
+            if (prev[l] + 1 < d) d = prev[l] + 1;
+            if (cur[l-1] + 1 < d) d = cur[l-1] + 1;
+            cur[l] = d;
+        }
+        size_t *tmp = prev;
+        prev = cur, cur = tmp;
+    }
+    size_t len = 0;
+    for (size_t l = 1; l <= w; ++l) {
+        size_t off = l > m ? l - m : m - l, best = len > m ? len - m : m - len;
+        if (prev[l] < prev[len] || (prev[l] == prev[len] && off < best)) len = l;
+    }
+    free(row);
+    return end - len;
+}
+
+static char *_fuzzy_str(const char *str, const char *sub, size_t k, size_t *len, bool fold) {
+    const unsigned char *t = (const unsigned char *)str, *p = (const unsigned char *)sub;
+    size_t m = strlen(sub), n = strlen(str), end = 0, start;
+    if (m <= k) {                                               // Deleting all of sub already matches the empty string
+        if (len) *len = 0;
+        return (char *)str;
+    }
+
+    uint64_t local[EXTENDED_ASCII_RANGE];
+    uint64_t *peq = m > _BLOCK ? malloc((m + _BLOCK - 1) / _BLOCK * EXTENDED_ASCII_RANGE * sizeof(uint64_t)) : local;
+    if (!peq) return NULL;
+    _build_peq(peq, p, m, fold);
+    size_t found = _scan(peq, m, t, n, true, k, &end);
+    if (peq != local) free(peq);
+    if (found == SIZE_MAX || (start = _match_start(p, m, t, end, k, fold)) == SIZE_MAX) return NULL;
+    if (len) *len = end - start;
+    return (char *)&str[start];
+}
+
+/* *************************************************************************************************************************
+ * strFuzzyStr / strCaseFuzzyStr - Finds the first substring of str within k edits of sub. The scan stops at the first
+ * position where a match within k edits ends, extended while the distance keeps dropping, so "abc" in "xabcx" with k = 1
+ * finds "abc" rather than "ab". An empty result (returned when sub has no more than k characters) matches at str
+ * *************************************************************************************************************************/
+
+char *strFuzzyStr(const char *str, const char *sub, size_t k, size_t *len) {
+    return _fuzzy_str(str, sub, k, len, false);
+}
+
+char *strCaseFuzzyStr(const char *str, const char *sub, size_t k, size_t *len) {
+    return _fuzzy_str(str, sub, k, len, true);
+}
+
+#if defined(__SSE2__)
+
+/* =========================================================================================================================
+ * _distance_batch8 - _distance_word for 8 candidates at once, one per 16-bit lane, for queries of 1-16 characters. The
+ * lanes step through their candidates together; a lane whose candidate has ended keeps its state and score. Only the
+ * match mask lookups are scalar
+ * ========================================================================================================================*/
+
+static void _distance_batch8(const uint16_t *peq, size_t m, const unsigned char *const *t, const size_t *len, size_t *dist) {
+    const __m128i ones = _mm_set1_epi16(-1), one = _mm_set1_epi16(1), last = _mm_set1_epi16((short)(1u << (m - 1)));
+    const __m128i lens = _mm_setr_epi16((short)len[0], (short)len[1], (short)len[2], (short)len[3],
+                                        (short)len[4], (short)len[5], (short)len[6], (short)len[7]);
+    __m128i vp = ones, vn = _mm_setzero_si128(), score = _mm_set1_epi16((short)m);
+    size_t steps = 0;
+    for (int l = 0; l < 8; ++l) if (len[l] > steps) steps = len[l];
+
+    for (size_t j = 0; j < steps; ++j) {
+        uint16_t e[8];
+        for (int l = 0; l < 8; ++l) e[l] = j < len[l] ? peq[t[l][j]] : 0;
+        __m128i eq = _mm_loadu_si128((const __m128i *)e), active = _mm_cmpgt_epi16(lens, _mm_set1_epi16((short)j));
+        __m128i d0 = _mm_or_si128(_mm_or_si128(_mm_xor_si128(_mm_add_epi16(_mm_and_si128(eq, vp), vp), vp), eq), vn);
+        __m128i hp = _mm_or_si128(vn, _mm_xor_si128(_mm_or_si128(d0, vp), ones)), hn = _mm_and_si128(d0, vp);
+        score = _mm_sub_epi16(score, _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(hp, last), last), active));
+        score = _mm_add_epi16(score, _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(hn, last), last), active));
+        hp = _mm_or_si128(_mm_slli_epi16(hp, 1), one), hn = _mm_slli_epi16(hn, 1);
+        __m128i nvp = _mm_or_si128(hn, _mm_xor_si128(_mm_or_si128(d0, hp), ones)), nvn = _mm_and_si128(hp, d0);
+        vp = _mm_or_si128(_mm_and_si128(active, nvp), _mm_andnot_si128(active, vp));
+        vn = _mm_or_si128(_mm_and_si128(active, nvn), _mm_andnot_si128(active, vn));
+    }
+
+    uint16_t s[8];
+    _mm_storeu_si128((__m128i *)s, score);
+    for (int l = 0; l < 8; ++l) dist[l] = s[l];
+}
+
+#endif
+
+/* *************************************************************************************************************************
+ * strLevenshteinAll - Distance from query to every candidate. The query's match masks are built once. Candidates whose
+ * length differs from the query's by more than max are rejected without being compared
+ * *************************************************************************************************************************/
+
+size_t strLevenshteinAll(const char *query, char **cands, size_t n, size_t max, size_t *dists, bool fold) {
+    const unsigned char *q = (const unsigned char *)query;
+    size_t m = strlen(query), within = 0, i = 0;
+    uint64_t local[EXTENDED_ASCII_RANGE];
+    uint64_t *peq = m > _BLOCK ? malloc((m + _BLOCK - 1) / _BLOCK * EXTENDED_ASCII_RANGE * sizeof(uint64_t)) : local;
+    if (!peq) return 0;
+    if (m) _build_peq(peq, q, m, fold);
+
+#if defined(__SSE2__)
+    if (m && m <= _BATCH_MAX_QUERY) {
+        uint16_t peq16[EXTENDED_ASCII_RANGE];
+        for (int c = 0; c < EXTENDED_ASCII_RANGE; ++c) peq16[c] = (uint16_t)peq[c];
+
+        // Gather candidates that pass the length filter into groups of 8. Ones too long for a 16-bit score are compared
+        // on their own with the word kernel instead
+        const unsigned char *group[8];
+        size_t lens[8], slot[8], d[8], filled = 0;
+        for (; i <= n; ++i) {
+            if (i < n) {
+                size_t len = cands[i] ? strlen(cands[i]) : SIZE_MAX;
+                bool near = len != SIZE_MAX && (len > m ? len - m : m - len) <= max;
+                if (!near) {
+                    if (dists) dists[i] = max + 1;
+                    continue;
+                }
+                if (len >= INT16_MAX) {
+                    size_t dist = _distance_word(peq, m, (const unsigned char *)cands[i], len, false);
+                    within += dist <= max;
+                    if (dists) dists[i] = dist;
+                    continue;
+                }
+                group[filled] = (const unsigned char *)cands[i], lens[filled] = len, slot[filled++] = i;
+                if (filled < 8) continue;
+            }
+            for (size_t l = filled; l < 8; ++l) group[l] = q, lens[l] = 0;     // Pad a short last group with idle lanes
+            if (filled) _distance_batch8(peq16, m, group, lens, d);
+            for (size_t l = 0; l < filled; ++l) {
+                within += d[l] <= max;
+                if (dists) dists[slot[l]] = d[l];
+            }
+            filled = 0;
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        size_t len = cands[i] ? strlen(cands[i]) : SIZE_MAX, d = max + 1;
+        if (len != SIZE_MAX && (len > m ? len - m : m - len) <= max) {
+            const unsigned char *t = (const unsigned char *)cands[i];
+            if (!m) d = len;
+            else if (m <= _BLOCK) d = _distance_word(peq, m, t, len, false);
+            else if ((d = _scan(peq, m, t, len, false, 0, NULL)) == SIZE_MAX) d = max + 1;
+        }
+        within += d <= max;
+        if (dists) dists[i] = d;
+    }
+    if (peq != local) free(peq);
+    return within;
+}
+
+/* *************************************************************************************************************************/
@@ -0,0 +1,46 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strfuzzy.h                                                                                                              *
+ *                                                                                                                         *
+ * Approximate string matching. Edit distances are computed with the bit-parallel algorithms of Myers and Hyyrö: one       *
+ * machine word holds a whole column of the dynamic programming table, so comparing against a 64 character string costs a  *
+ * handful of word operations per character instead of 64 cell updates. Longer strings are split into 64-bit blocks.       *
+ * strLevenshteinAll compares one query against many candidates, building the query's tables once and, for queries of up   *
+ * to 16 characters, running 8 candidates at a time in the 16-bit lanes of an SSE2 register.                               *
+ * ======================================================================================================================= */
+
+#ifndef strfuzzy_h
+#define strfuzzy_h
+
+#include <stdint.h>
+#include "strings.h"
+
+/* *************************************************************************************************************************/
+// No macro versions. Levenshtein distance counts insertions, deletions and substitutions. Damerau distance (optimal string
+// alignment) also counts a transposition of two adjacent characters as one edit
+
+extern size_t strLevenshtein(const char *s1, const char *s2);
+extern size_t strCaseLevenshtein(const char *s1, const char *s2);
+extern size_t strDamerau(const char *s1, const char *s2);
+extern size_t strCaseDamerau(const char *s1, const char *s2);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions. Fuzzy strStr: returns the start of the first substring of str within k edits of sub (NULL if there is
+// none) and stores its length in *len unless len is NULL
+
+extern char *strFuzzyStr(const char *str, const char *sub, size_t k, size_t *len);
+extern char *strCaseFuzzyStr(const char *str, const char *sub, size_t k, size_t *len);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions. Computes strLevenshtein (strCaseLevenshtein if fold is set) between query and every candidate and
+// returns the number within max edits. Unless dists is NULL, dists[i] gets the distance, or max + 1 for candidates that
+// can't be within max edits (including NULL entries)
+
+extern size_t strLevenshteinAll(const char *query, char **cands, size_t n, size_t max, size_t *dists, bool fold);
+/* *************************************************************************************************************************/
+
+#endif /* strfuzzy_h */
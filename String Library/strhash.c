@@ -0,0 +1,194 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strhash.c                                                                                                               *
+ * ======================================================================================================================= */
+
+#include <string.h>
+#include <time.h>
+#include "strhash.h"
+
+/* =========================================================================================================================
+ * _P0 - _P3 - Odd 64-bit constants with balanced bits, used as secrets for the mixing rounds
+ * ========================================================================================================================*/
+
+#define _P0 0xa0761d6478bd642fULL
+#define _P1 0xe7037ed1a0b428dbULL
+#define _P2 0x8ebc6af09c88c6e3ULL
+#define _P3 0x589965cc75374cc3ULL
+
+/* =========================================================================================================================
+ * _mix - Multiplies a and b to 128 bits and folds the halves together with XOR. This one instruction pair does most of
+ * the diffusion: every input bit affects the middle bits of the product
+ * ========================================================================================================================*/
+
+static inline uint64_t _mix(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+/* =========================================================================================================================
+ * _fold - Lowercases the 8 characters packed in w (SWAR). Matches lc: only bytes 'A'-'Z' gain the 0x20 bit
+ * ========================================================================================================================*/
+
+static inline uint64_t _fold(uint64_t w) {
+    const uint64_t ones = 0x0101010101010101ULL, high = 0x8080808080808080ULL;
+    uint64_t low7 = w & ~high;                                     // Clear each byte's top bit so the adds can't carry over
+    uint64_t ge_A = low7 + (0x80 - 'A') * ones;                    // Top bit set where byte >= 'A'
+    uint64_t gt_Z = low7 + (0x7F - 'Z') * ones;                    // Top bit set where byte > 'Z'
+    uint64_t upper = (ge_A ^ gt_Z) & ~w & high;                    // ...and the original byte was ASCII
+    return w | (upper >> 2);
+}
+
+/* =========================================================================================================================
+ * _secret - Derives the per-seed key. Every multiply takes it in its second operand, so the inputs that zero a product
+ * (and collide whatever follows) depend on the seed instead of on the public constants
+ * ========================================================================================================================*/
+
+static inline uint64_t _secret(uint64_t seed) {
+    return seed ^ _mix(seed ^ _P0, _P1);
+}
+
+static inline uint64_t _read64(const uint8_t *p) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    return w;
+}
+
+/* =========================================================================================================================
+ * _stripe - Mixes one 32 byte stripe into the two accumulators. The halves are independent, so the two multiplies of a
+ * stripe can execute in parallel
+ * ========================================================================================================================*/
+
+static inline void _stripe(uint64_t *h0, uint64_t *h1, const uint8_t *p, uint64_t secret, bool fold) {
+    uint64_t w0 = _read64(p), w1 = _read64(p + 8), w2 = _read64(p + 16), w3 = _read64(p + 24);
+    if (fold) w0 = _fold(w0), w1 = _fold(w1), w2 = _fold(w2), w3 = _fold(w3);
+    *h0 = _mix(w0 ^ _P0 ^ *h0, w1 ^ _P1 ^ secret);
+    *h1 = _mix(w2 ^ _P2 ^ *h1, w3 ^ _P3 ^ secret);
+}
+
+/* =========================================================================================================================
+ * _read_partial - Reads m <= 8 bytes as a zero padded little endian word. Uses two overlapping loads instead of a byte
+ * loop: bytes covered by both loads land in the same position, so OR-ing them gives the exact padded value
+ * ========================================================================================================================*/
+
+static inline uint64_t _read_partial(const uint8_t *p, size_t m) {
+    uint32_t a, b;
+    if (m >= 8) return _read64(p);
+    if (m >= 4) {
+        memcpy(&a, p, 4), memcpy(&b, p + m - 4, 4);
+        return (uint64_t)a | (uint64_t)b << (8 * (m - 4));
+    }
+    return m ? (uint64_t)p[0] | (uint64_t)p[m/2] << (8 * (m/2)) | (uint64_t)p[m-1] << (8 * (m-1)) : 0;
+}
+
+/* =========================================================================================================================
+ * _finish - Mixes the final 0-31 bytes (as a zero padded stripe), then combines the accumulators with the total length
+ * ========================================================================================================================*/
+
+static inline uint64_t _finish(uint64_t h0, uint64_t h1, const uint8_t *tail, size_t r, uint64_t len, uint64_t secret,
+                               bool fold) {
+    uint64_t w0 = _read_partial(tail, r), w1 = r > 8 ? _read_partial(tail + 8, r - 8) : 0;
+    uint64_t w2 = r > 16 ? _read_partial(tail + 16, r - 16) : 0, w3 = r > 24 ? _read_partial(tail + 24, r - 24) : 0;
+    if (fold) w0 = _fold(w0), w1 = _fold(w1), w2 = _fold(w2), w3 = _fold(w3);
+    h0 = _mix(w0 ^ _P0 ^ h0, w1 ^ _P1 ^ secret);
+    h1 = _mix(w2 ^ _P2 ^ h1, w3 ^ _P3 ^ secret);
+    return _mix(_mix(h0 ^ _P0, h1 ^ len ^ _P1 ^ secret) ^ _P2, len ^ _P3 ^ secret);
+}
+
+static inline uint64_t _hash(const uint8_t *p, size_t n, uint64_t seed, bool fold) {
+    uint64_t h0 = seed ^ _P2, h1 = seed ^ _P3, len = n, secret = _secret(seed);
+    for (; n >= STRHASH_STRIPE; p += STRHASH_STRIPE, n -= STRHASH_STRIPE) _stripe(&h0, &h1, p, secret, fold);
+    return _finish(h0, h1, p, n, len, secret, fold);
+}
+
+/* *************************************************************************************************************************
+ * strHash - String hash - 64-bit hash of str with the given seed
+ * *************************************************************************************************************************/
+
+uint64_t strHash(const char *str, uint64_t seed) {
+    return _hash((const uint8_t *)str, strlen(str), seed, false);
+}
+
+/* *************************************************************************************************************************
+ * strCaseHash - String hash - Case insensitive - Hashes str as if it had been converted with strLwr
+ * *************************************************************************************************************************/
+
+uint64_t strCaseHash(const char *str, uint64_t seed) {
+    return _hash((const uint8_t *)str, strlen(str), seed, true);
+}
+
+/* *************************************************************************************************************************
+ * strHashN - String hash - 64-bit hash of the n bytes at data with the given seed
+ * *************************************************************************************************************************/
+
+uint64_t strHashN(const void *data, size_t n, uint64_t seed) {
+    return _hash(data, n, seed, false);
+}
+
+/* *************************************************************************************************************************
+ * strCaseHashN - String hash - Case insensitive - 64-bit hash of the n bytes at data with A-Z folded to a-z
+ * *************************************************************************************************************************/
+
+uint64_t strCaseHashN(const void *data, size_t n, uint64_t seed) {
+    return _hash(data, n, seed, true);
+}
+
+/* *************************************************************************************************************************
+ * strHashInit - Starts a streaming hash. 'fold' selects the case insensitive variant
+ * *************************************************************************************************************************/
+
+void strHashInit(StrHashState *state, uint64_t seed, bool fold) {
+    state->h0 = seed ^ _P2, state->h1 = seed ^ _P3, state->secret = _secret(seed);
+    state->len = 0, state->buffered = 0, state->fold = fold;
+}
+
+/* *************************************************************************************************************************
+ * strHashUpdate - Adds n bytes to a streaming hash. Input may be split at any point
+ * *************************************************************************************************************************/
+
+void strHashUpdate(StrHashState *state, const void *data, size_t n) {
+    const uint8_t *p = data;
+    state->len += n;
+
+    // Top up a partially filled stripe first
+    if (state->buffered) {
+        size_t take = STRHASH_STRIPE - state->buffered < n ? STRHASH_STRIPE - state->buffered : n;
+        memcpy(state->buffer + state->buffered, p, take);
+        state->buffered += take, p += take, n -= take;
+        if (state->buffered < STRHASH_STRIPE) return;
+        _stripe(&state->h0, &state->h1, state->buffer, state->secret, state->fold);
+        state->buffered = 0;
+    }
+
+    // Whole stripes straight from the input, then keep the remainder for later
+    for (; n >= STRHASH_STRIPE; p += STRHASH_STRIPE, n -= STRHASH_STRIPE)
+        _stripe(&state->h0, &state->h1, p, state->secret, state->fold);
+    memcpy(state->buffer, p, n);
+    state->buffered = n;
+}
+
+/* *************************************************************************************************************************
+ * strHashFinal - Returns the hash of everything added so far. The state is not modified, so hashing can continue
+ * *************************************************************************************************************************/
+
+uint64_t strHashFinal(const StrHashState *state) {
+    return _finish(state->h0, state->h1, state->buffer, state->buffered, state->len, state->secret, state->fold);
+}
+
+/* *************************************************************************************************************************
+ * strHashSeed - Returns a random seed from /dev/urandom, falling back to the clock and an address if it can't be read
+ * *************************************************************************************************************************/
+
+uint64_t strHashSeed(void) {
+    uint64_t seed = 0;
+    FILE *urandom = fopen("/dev/urandom", "rb");
+    if (!urandom || fread(&seed, sizeof(seed), 1, urandom) != 1) {
+        struct timespec ts;
+        timespec_get(&ts, TIME_UTC);
+        seed = _mix((uint64_t)ts.tv_sec ^ _P0, (uint64_t)ts.tv_nsec ^ (uint64_t)(uintptr_t)&ts ^ _P1);
+    }
+    if (urandom) fclose(urandom);
+    return seed;
+}
+
+/* *************************************************************************************************************************/
@@ -0,0 +1,55 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strhash.h                                                                                                               *
+ *                                                                                                                         *
+ * Fast non-cryptographic 64-bit string hashing (wyhash style: 128-bit multiply-and-fold mixing over 32 byte stripes).     *
+ * Every function takes a seed, so hash tables exposed to untrusted keys can pick a random one (strHashSeed) to resist     *
+ * collision flooding. The case insensitive variants fold A-Z to a-z while hashing, so strCaseHash("Key") equals           *
+ * strHash("key"). The streaming interface produces the same value as the one-shot functions for the same bytes.           *
+ * ======================================================================================================================= */
+
+#ifndef strhash_h
+#define strhash_h
+
+#include <stdint.h>
+#include "strings.h"
+
+#define STRHASH_STRIPE 32               // Bytes consumed per mixing round
+
+/* *************************************************** TYPEDEFS ************************************************************/
+typedef struct {                        /* Struct holding the state of a streaming hash */
+    uint64_t h0, h1;                    // Two independent accumulators, one per half of each stripe
+    uint64_t secret;                    // Key derived from the seed, mixed into both operands of every multiply
+    uint64_t len;                       // Total number of bytes hashed so far
+    uint8_t buffer[STRHASH_STRIPE];     // Bytes waiting for a full stripe
+    size_t buffered;                    // Number of bytes in buffer
+    bool fold;                          // Case insensitive (fold A-Z while hashing)
+} StrHashState;
+
+/* *************************************************************************************************************************/
+#define strHash_(str) strHashN((str), strLen(str), 0)
+#define strCaseHash_(str) strCaseHashN((str), strLen(str), 0)
+
+extern uint64_t strHash(const char *str, uint64_t seed);
+extern uint64_t strCaseHash(const char *str, uint64_t seed);
+extern uint64_t strHashN(const void *data, size_t n, uint64_t seed);
+extern uint64_t strCaseHashN(const void *data, size_t n, uint64_t seed);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern void strHashInit(StrHashState *state, uint64_t seed, bool fold);
+extern void strHashUpdate(StrHashState *state, const void *data, size_t n);
+extern uint64_t strHashFinal(const StrHashState *state);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro version
+
+extern uint64_t strHashSeed(void);
+/* *************************************************************************************************************************/
+
+#endif /* strhash_h */
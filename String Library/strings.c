@@ -3,7 +3,16 @@
  * strings.c                                                                                                               *
  * ======================================================================================================================= */
 
+#define _GNU_SOURCE                     // memmem, strnlen
+
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "strings.h"
+#include "strfixed.h"
+#include "strsimd.h"                    // _simd_lc, _simd_uc
 
 /* =========================================================================================================================
  * _swap_iter - Iterator swap
@@ -11,13 +20,54 @@
 
 #define _swap_iter(a, b) ({ char tmp = *a; *a = *b; *b = tmp; })
 
+/* =========================================================================================================================
+ * _page_safe - True if a 16 byte load starting at p stays within p's page. Lets the SIMD kernels read ahead of a string's
+ * NUL without faulting, the same way libc's string functions do
+ * ========================================================================================================================*/
+
+#define _page_safe(p) (((uintptr_t)(p) & 4095) <= 4096 - 16)
+
+/* =========================================================================================================================
+ * _READS_AHEAD - Marks the functions whose SIMD loops read past the NUL (within its page, see _page_safe). AddressSanitizer
+ * can't tell those reads from real overflows, so they are left uninstrumented in sanitized builds
+ * ========================================================================================================================*/
+
+#if defined(__SANITIZE_ADDRESS__)
+    #define _READS_AHEAD __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define _READS_AHEAD __attribute__((no_sanitize_address))
+    #endif
+#endif
+#ifndef _READS_AHEAD
+    #define _READS_AHEAD
+#endif
+
+#if defined(__SSE2__)
+
+/* =========================================================================================================================
+ * _simd_has_nul - Bitmask of the NUL characters in a 16 character block
+ * ========================================================================================================================*/
+
+static inline int _simd_has_nul(__m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+}
+
+#endif
+
 
 /* *************************************************************************************************************************
  * strUpr - Converts string to uppercase
  * *************************************************************************************************************************/
 
-inline char *strUpr(char *str) {
+_READS_AHEAD inline char *strUpr(char *str) {
     char *s = (str && *str) ? str : NULL;
+#if defined(__SSE2__)
+    // Convert up to the first 16 byte boundary, then a whole aligned block per iteration until the block holding the NUL
+    for (; ((uintptr_t)str & 15) && *str; ++str) *str = uc(*str);
+    for (__m128i v; *str && !_simd_has_nul(v = _mm_load_si128((__m128i *)str)); str += 16)
+        _mm_store_si128((__m128i *)str, _simd_uc(v));
+#endif
     while ((*str = *str > 0x60 && *str < 0x7b ? *str&0x5F : *str) && ++str);
     return s;
 }
@@ -26,20 +76,88 @@ inline char *strUpr(char *str) {
  * strLwr - Converts string to lowercase
  * *************************************************************************************************************************/
 
-inline char *strLwr(char *str) {
+_READS_AHEAD inline char *strLwr(char *str) {
     char *s = (str && *str) ? str : NULL;
+#if defined(__SSE2__)
+    for (; ((uintptr_t)str & 15) && *str; ++str) *str = lc(*str);
+    for (__m128i v; *str && !_simd_has_nul(v = _mm_load_si128((__m128i *)str)); str += 16)
+        _mm_store_si128((__m128i *)str, _simd_lc(v));
+#endif
     while ((*str = *str > 0x40 && *str < 0x5b ? *str|0x60 : *str) && ++str);
     return s;
 }
 
+/* *************************************************************************************************************************
+ * strnUpr - Converts the first n characters to uppercase. Doesn't stop at NUL, so it can fold packed (non-terminated) data
+ * *************************************************************************************************************************/
+
+inline char *strnUpr(char *str, size_t n) {
+    register size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16)
+        _mm_storeu_si128((__m128i *)&str[i], _simd_uc(_mm_loadu_si128((const __m128i *)&str[i])));
+#endif
+    for (; i < n; ++i) str[i] = uc(str[i]);
+    return str;
+}
+
+/* *************************************************************************************************************************
+ * strnLwr - Converts the first n characters to lowercase. Doesn't stop at NUL, so it can fold packed (non-terminated) data
+ * *************************************************************************************************************************/
+
+inline char *strnLwr(char *str, size_t n) {
+    register size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16)
+        _mm_storeu_si128((__m128i *)&str[i], _simd_lc(_mm_loadu_si128((const __m128i *)&str[i])));
+#endif
+    for (; i < n; ++i) str[i] = lc(str[i]);
+    return str;
+}
+
+/* *************************************************************************************************************************
+ * strUprAll - Converts every string in an array of n strings to uppercase. NULL entries are skipped. Returns the number
+ * of strings converted
+ * *************************************************************************************************************************/
+
+inline size_t strUprAll(char **strs, size_t n) {
+    size_t converted = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (strs[i]) strUpr(strs[i]), ++converted;
+    }
+    return converted;
+}
+
+/* *************************************************************************************************************************
+ * strLwrAll - Converts every string in an array of n strings to lowercase. NULL entries are skipped. Returns the number
+ * of strings converted
+ * *************************************************************************************************************************/
+
+inline size_t strLwrAll(char **strs, size_t n) {
+    size_t converted = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (strs[i]) strLwr(strs[i]), ++converted;
+    }
+    return converted;
+}
+
 /* *************************************************************************************************************************
  * strLen - String length
  * *************************************************************************************************************************/
 
-inline size_t strLen(const char *str) {
-    char *s;
-    for (s = (char*)str; *s && *++s; ++s);
+_READS_AHEAD inline size_t strLen(const char *str) {
+#if defined(__SSE2__)
+    // Aligned blocks never cross a page, so the first block may start before str: its leading bytes are masked off
+    const char *block = (const char *)((uintptr_t)str & ~(uintptr_t)15);
+    int nul = _simd_has_nul(_mm_load_si128((const __m128i *)block)) >> (str - block);
+    if (nul) return (size_t)__builtin_ctz(nul);
+    do block += 16; while (!(nul = _simd_has_nul(_mm_load_si128((const __m128i *)block))));
+    return (size_t)(block + __builtin_ctz(nul) - str);
+#else
+    const char *s = str;
+    while (*s) ++s;
     return (size_t)(s - str);
+#endif
 }
 
 /* *************************************************************************************************************************
@@ -48,16 +166,33 @@ inline size_t strLen(const char *str) {
 
 inline int strCmp(const char *s1, const char *s2) {
     for (; *s1 && *s1 == *s2; ++s1, ++s2);
-    return (int)(*s1 - *s2);
+    return (int)((unsigned char)*s1 - (unsigned char)*s2);
 }
 
 /* *************************************************************************************************************************
  * strCaseCmp - String compare - Case insensitive
  * *************************************************************************************************************************/
 
-inline int strCaseCmp(const char *s1, const char *s2) {
+_READS_AHEAD inline int strCaseCmp(const char *s1, const char *s2) {
+#if defined(__SSE2__)
+    // Fold both sides and compare 16 characters per step. A clear bit in 'eq' marks the first mismatch or NUL in s1.
+    // Steps that would read across a page boundary are done one character at a time instead
+    for (;;) {
+        if (_page_safe(s1) && _page_safe(s2)) {
+            __m128i a = _mm_loadu_si128((const __m128i *)s1), b = _mm_loadu_si128((const __m128i *)s2);
+            int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(_simd_lc(a), _simd_lc(b))) & ~_simd_has_nul(a);
+            if (eq != 0xFFFF) {
+                int i = __builtin_ctz(~eq);
+                return (int)((unsigned char)lc(s1[i]) - (unsigned char)lc(s2[i]));
+            }
+            s1 += 16, s2 += 16;
+        } else if (*s1 && lc(*s1) == lc(*s2)) {
+            ++s1, ++s2;
+        } else break;
+    }
+#endif
     for (; *s1 && lc(*s1) == lc(*s2); ++s1, ++s2);
-    return (int)(lc(*s1) - lc(*s2));
+    return (int)((unsigned char)lc(*s1) - (unsigned char)lc(*s2));
 }
 
 /* *************************************************************************************************************************
@@ -65,17 +200,35 @@ inline int strCaseCmp(const char *s1, const char *s2) {
  * *************************************************************************************************************************/
 
 inline int strnCmp(const char *s1, const char *s2, long int n) {
-    for (; --n > 0 && *s1 && *s1 == *s2; ++s1, ++s2);               // If argument of n = 0 is used, 1st chars compared
-    return (int)(*s1 - *s2);
+    if (n <= 0) return 0;                                           // No characters compared, so the strings are equal
+    for (; --n > 0 && *s1 && *s1 == *s2; ++s1, ++s2);
+    return (int)((unsigned char)*s1 - (unsigned char)*s2);
 }
 
 /* *************************************************************************************************************************
  * strnCaseCmp - String compare - First n characters - Case insensitive
  * *************************************************************************************************************************/
 
-inline int strnCaseCmp(const char *s1, const char *s2, long int n) {
+_READS_AHEAD inline int strnCaseCmp(const char *s1, const char *s2, long int n) {
+    if (n <= 0) return 0;
+#if defined(__SSE2__)
+    // Same as strCaseCmp, but only while a full block still lies within the first n-1 characters
+    while (n > 16) {
+        if (_page_safe(s1) && _page_safe(s2)) {
+            __m128i a = _mm_loadu_si128((const __m128i *)s1), b = _mm_loadu_si128((const __m128i *)s2);
+            int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(_simd_lc(a), _simd_lc(b))) & ~_simd_has_nul(a);
+            if (eq != 0xFFFF) {
+                int i = __builtin_ctz(~eq);
+                return (int)((unsigned char)lc(s1[i]) - (unsigned char)lc(s2[i]));
+            }
+            s1 += 16, s2 += 16, n -= 16;
+        } else if (*s1 && lc(*s1) == lc(*s2)) {
+            ++s1, ++s2, --n;
+        } else break;
+    }
+#endif
     for (; --n > 0 && *s1 && lc(*s1) == lc(*s2); ++s1, ++s2);
-    return (int)(lc(*s1) - lc(*s2));
+    return (int)((unsigned char)lc(*s1) - (unsigned char)lc(*s2));
 }
 
 /* *************************************************************************************************************************
@@ -94,8 +247,20 @@ inline ptrdiff_t strCpy(char *restrict dest, const char *restrict source) {
  * pointer to destination string, use macro version strCaseCopy_
  * *************************************************************************************************************************/
 
-inline ptrdiff_t strCaseCpy(char *restrict dest, const char *restrict source) {
+_READS_AHEAD inline ptrdiff_t strCaseCpy(char *restrict dest, const char *restrict source) {
     char *s = dest;
+#if defined(__SSE2__)
+    // Fold and copy whole blocks until the block holding the NUL, which is finished by the scalar loop
+    for (__m128i v;;) {
+        if (!_page_safe(source)) {
+            if (!(*dest = lc(*source))) return dest - s;
+            ++dest, ++source;
+        } else if (!_simd_has_nul(v = _mm_loadu_si128((const __m128i *)source))) {
+            _mm_storeu_si128((__m128i *)dest, _simd_lc(v));
+            dest += 16, source += 16;
+        } else break;
+    }
+#endif
     for (*dest = lc(*source); *source++; *++dest = lc(*source));
     return dest - s;
 }
@@ -117,8 +282,12 @@ inline ptrdiff_t strnCpy(char *restrict dest, const char *restrict source, size_
  * *************************************************************************************************************************/
 
 inline ptrdiff_t strnCaseCpy(char *restrict dest, const char *restrict source, size_t n) {
-    register size_t i;
-    for (i = 0; i < n; ++i) dest[i] = lc(source[i]);
+    register size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16)
+        _mm_storeu_si128((__m128i *)&dest[i], _simd_lc(_mm_loadu_si128((const __m128i *)&source[i])));
+#endif
+    for (; i < n; ++i) dest[i] = lc(source[i]);
     return &dest[i] - dest;
 }
 
@@ -140,10 +309,8 @@ inline ptrdiff_t strCat(char *restrict dest, const char *restrict source) {
  * *************************************************************************************************************************/
 
 inline ptrdiff_t strCaseCat(char *restrict dest, const char *restrict source) {
-    char *s;
-    while (*dest++);
-    for (s = --dest, *dest = lc(*source); *source; *++dest = lc(*++source));
-    return dest - s;
+    while (*dest) ++dest;
+    return strCaseCpy(dest, source);
 }
 
 /* *************************************************************************************************************************
@@ -151,7 +318,10 @@ inline ptrdiff_t strCaseCat(char *restrict dest, const char *restrict source) {
  * *************************************************************************************************************************/
 
 inline char *strCharCat(char *dest, char src) {
-    for (char *s = !dest ? NULL : *dest ? dest + 1 : dest; s && (*s || (!(*s = src) && src)); ++s); // Verifies no NULL arguments
+    if (dest && src) {                                              // Nothing to append to a NULL dest or for a NUL src
+        char *end = dest + strlen(dest);
+        end[0] = src, end[1] = '\0';
+    }
     return dest;
 }
 
@@ -161,7 +331,10 @@ inline char *strCharCat(char *dest, char src) {
  * *************************************************************************************************************************/
 
 inline char *strCaseCharCat(char *dest, char src) {
-    for (char *s = !dest ? NULL : *dest ? dest + 1 : dest; s && (*s || (!(*s = lc(src)) && src)); ++s); // Verifies no NULL arguments
+    if (dest && src) {                                              // Nothing to append to a NULL dest or for a NUL src
+        char *end = dest + strlen(dest);
+        end[0] = lc(src), end[1] = '\0';
+    }
     return dest;
 }
 
@@ -171,8 +344,8 @@ inline char *strCaseCharCat(char *dest, char src) {
  * *************************************************************************************************************************/
 
 inline char *strChr(const char *str, unsigned char ch) {
-    for (; *str!=ch && (*str || ch=='\0'); ++str);  // Search until match is found or end of string reached
-    return *str==ch ? (char *)str : NULL;           // Return position of 'ch' in 'str' or NULL if no match found
+    for (; (unsigned char)*str!=ch && *str; ++str);         // Search until match is found or end of string reached
+    return (unsigned char)*str==ch ? (char *)str : NULL;    // Return position of 'ch' in 'str' or NULL if no match found
 }
 
 
@@ -181,9 +354,27 @@ inline char *strChr(const char *str, unsigned char ch) {
  * *************************************************************************************************************************/
 
 // Character sseach, case insensitive
-inline char *strCaseChr(const char *str, unsigned char ch) {
-    for (ch = lc(ch); lc(*str)!=ch && (*str || ch=='\0'); ++str); // Search until match is found or end of string reached
-    return lc(*str)==ch ? (char *)str : NULL;                     // Return position of 'ch' in 'str' or NULL if no match found
+_READS_AHEAD inline char *strCaseChr(const char *str, unsigned char ch) {
+    ch = lc(ch);
+#if defined(__SSE2__)
+    // Fold each block and look for either the character or the NUL, whichever comes first
+    for (__m128i c = _mm_set1_epi8((char)ch);;) {
+        if (!_page_safe(str)) {
+            if ((unsigned char)lc(*str)==ch || !*str) break;
+            ++str;
+            continue;
+        }
+        __m128i v = _mm_loadu_si128((const __m128i *)str);
+        int hit = _mm_movemask_epi8(_mm_cmpeq_epi8(_simd_lc(v), c)) | _simd_has_nul(v);
+        if (hit) {
+            str += __builtin_ctz(hit);
+            break;
+        }
+        str += 16;
+    }
+#endif
+    for (; (unsigned char)lc(*str)!=ch && *str; ++str);            // Search until match is found or end of string reached
+    return (unsigned char)lc(*str)==ch ? (char *)str : NULL;       // Return position of 'ch' in 'str' or NULL if no match found
 }
 
 
@@ -192,7 +383,7 @@ inline char *strCaseChr(const char *str, unsigned char ch) {
  * *************************************************************************************************************************/
 
 inline char *strReverse(char *str) {
-    for (char *s1 = str, *s2 = s1 + strLen(str) - 1; s1 < s2; ++s1, --s2)   // Reverse str in place
+    for (char *s1 = str, *s2 = str + strLen(str); s1 < s2 && s1 < --s2; ++s1)   // Reverse str in place
         _swap_iter(s1,s2);                                                  // Swap elements
     return str;
 }
@@ -204,7 +395,7 @@ inline char *strReverse(char *str) {
 
 // Reverses the first n characters of the string 'source' and saves them to 'dest'
 inline char *strnReverse(char *restrict dest, char *restrict source, size_t n) {
-    for (char *s1 = dest, *s2 = source + n - 1; *s2 && s1 < dest + n; *s1++ = *s2--);
+    for (char *s1 = dest, *s2 = source + n; s1 < dest + n && s2[-1]; *s1++ = *--s2);    // Never steps before source (n = 0)
     return dest;
 }
 
@@ -213,13 +404,10 @@ inline char *strnReverse(char *restrict dest, char *restrict source, size_t n) {
  * strMove - String move
  * *************************************************************************************************************************/
 
-// Doesn't seem to be working with overlaps. Seems to have the same functionality as strnCpy?
+// Copies n characters from source to dest, which may overlap. Returns NULL if n is 0 or either pointer is NULL
 inline char *strMove(char *dest, char *source, size_t n) {
-    size_t i;
-    char *s = (n && dest && source) ? dest : NULL;                  // Make sure all parameters are vaid and set s accordingly
-    for (i = s ? 0 : n; i < n; ++i)                                 // If s is not null, copy first char to dest. Otherwise set i = n so loop never executes
-        dest[i] = source[i];
-    return s;
+    if (!n || !dest || !source) return NULL;
+    return memmove(dest, source, n);
 }
 
 
@@ -228,43 +416,26 @@ inline char *strMove(char *dest, char *source, size_t n) {
  * *************************************************************************************************************************/
 
 inline char *strCaseMove(char *dest, char *source, size_t n) {
-    size_t i;
-    char *s = (n && dest && source) ? dest : NULL;
-    for (i = s ? 0 : n; i < n; ++i)
-        dest[i] = source[i];
-    return s;
+    if (!n || !dest || !source) return NULL;
+    return strnLwr(memmove(dest, source, n), n);                    // Folding after the move gives the same result
 }
 
 
+/* =========================================================================================================================
+ * _find - Returns the first occurrence of needle[0, m) in s[0, n), or NULL. m > 0. Case sensitive searches use memmem
+ * (linear time), case insensitive ones the first/last character SIMD filter from strfixed.h
+ * ========================================================================================================================*/
+
+static inline const char *_find(const char *s, size_t n, const char *needle, size_t m, bool fold) {
+    return fold ? _strfixed_find(s, n, needle, m, true) : memmem(s, n, needle, m);
+}
+
 /* *************************************************************************************************************************
- * strStr - String substring search
+ * strStr - String substring search - Returns the first occurrence of sub in str (str itself if sub is empty), or NULL
  * *************************************************************************************************************************/
 
 inline char *strStr(char *str, char *sub) {
-    
-    enum {INITIAL, MATCH, MISMATCH} state = INITIAL;
-    register size_t idx = 0, matched = 0;
-    
-    while (str[idx] && sub[matched]) {
-        switch (state) {
-            case INITIAL:
-                if (str[idx]==sub[matched])
-                    ++matched, state = MATCH;
-                 else state = MISMATCH;
-            break;
-            case MATCH:
-                if (str[idx]==sub[matched])
-                    ++matched;
-                else matched = 0, state = MISMATCH;
-            break;
-            case MISMATCH:
-                if (str[idx]==sub[matched])
-                    ++matched, state = MATCH;
-            break;
-        }
-        ++idx;
-    }
-    return str[idx] ? &str[idx-matched] : NULL;
+    return *sub ? (char *)_find(str, strlen(str), sub, strlen(sub), false) : str;
 }
 
 
@@ -272,187 +443,505 @@ inline char *strStr(char *str, char *sub) {
  * strCaseStr - String substring search - Case insensitive
  * *************************************************************************************************************************/
 
-// Sub-string seach, case insensitive. Returns a pointer to the starting index of the given substring in 'str', or NULL if 'sub' is not a substring of 'str'.
 inline char *strCaseStr(char *str, char *sub) {
-    
-    enum {INITIAL, MATCH, MISMATCH} state = INITIAL;
-    register size_t idx = 0, matched = 0;
-    
-    while (str[idx] && sub[matched]) {              // Continues iterating until: a) the null char in str is reached or b) the substring has been found
-        switch (state) {                            // Keeps track of the position in str and the number of characters matched using FSM
-            case INITIAL:
-                if (lc(str[idx])==lc(sub[matched])) // Initial State <=> If first element is a match, increment matched and set state = Match. If not, set state = Mismatch
-                    ++matched, state = MATCH;
-                else state = MISMATCH;
-                break;
-            case MATCH:                             // Match State <=> If current element is a match, increment matched. If not, set matched = 0 and state = Mismatch
-                if (lc(str[idx])==lc(sub[matched]))
-                    ++matched;
-                else matched = 0, state = MISMATCH;
-                break;
-            case MISMATCH:                          // Mismatch State <=> If current element is a match, increment matched and set state = Match
-                if (lc(str[idx])==lc(sub[matched]))
-                    ++matched, state = MATCH;
-                break;
-        }
-        ++idx;                                      // Move 1 position forward each iteration
-    }
-    return str[idx] ? &str[idx-matched] : NULL;     // If null character in str has not been reached, return the starting index where substring is located, otherwise return null.
+    return *sub ? (char *)_find(str, strlen(str), sub, strlen(sub), true) : str;
+}
+
+/* =========================================================================================================================
+ * _str_alloc / _str_free - Allocate (or resize) and release through a caller's StrAllocator, falling back to the C
+ * library for unset hooks. A failed allocation is recorded in the allocator's error field, never in errno
+ * ========================================================================================================================*/
+
+static inline void *_str_alloc(StrAllocator *alloc, void *ptr, size_t size) {
+    void *p = alloc->resize ? alloc->resize(alloc->ctx, ptr, size) : realloc(ptr, size);
+    if (!p) alloc->error = ENOMEM;
+    return p;
+}
+
+static inline void _str_free(StrAllocator *alloc, void *ptr) {
+    if (!ptr) return;
+    if (alloc->release) alloc->release(alloc->ctx, ptr);
+    else free(ptr);
 }
 
 /* =========================================================================================================================
  * _add_sstr_loc - Add substring location - Used by strAll functions
- * Adds address of substring to pointer array and allocates additional memory if needed
+ * Stores new_substring as entry pos - 1 of the NULL terminated pointer array, doubling its space when it is full.
+ * Returns false if the array couldn't grow
  * ========================================================================================================================*/
 
-#define _add_sstr_loc(substrs,new_substring,pos)                                                                          \
-do {                                                                                                                     \
-    char **tmp_substrs = realloc(substrs, (pos == substr_space ? substr_space*=2 : substr_space) * sizeof(char *));      \
-    if (tmp_substrs) {                                                                                                   \
-        substrs = tmp_substrs;                                                                                           \
-        substrs[needles_found-1] = new_substring;                                                                        \
-        substrs[needles_found] = NULL;                                                                                   \
-    } else {                                                                                                             \
-        errno = 12;                                                                                                      \
-        return substrs;                                                                                                  \
-    }                                                                                                                    \
-} while (0)
+static inline bool _add_sstr_loc(StrAllocator *alloc, char ***substrs, size_t *substr_space, char *new_substring, size_t pos) {
+    if (pos == *substr_space) {
+        char **tmp_substrs = _str_alloc(alloc, *substrs, *substr_space * 2 * sizeof(char *));
+        if (!tmp_substrs) return false;
+        *substrs = tmp_substrs, *substr_space *= 2;
+    }
+    (*substrs)[pos-1] = new_substring;
+    (*substrs)[pos] = NULL;
+    return true;
+}
+
+/* =========================================================================================================================
+ * _all_str - strAllStrWith / strCaseAllStrWith. Matches don't overlap: the search resumes after the end of each match
+ * ========================================================================================================================*/
+
+static char **_all_str(StrAllocator *alloc, char *str, char *sub, bool fold) {
+    size_t n = strlen(str), m = strlen(sub), needles_found = 0, substr_space = 4;
+    char **sub_strings = _str_alloc(alloc, NULL, substr_space * sizeof(char *));
+    if (!sub_strings) return NULL;
+    sub_strings[0] = NULL;
+    if (m) {
+        for (char *p = str; (p = (char *)_find(p, n - (size_t)(p - str), sub, m, fold)); p += m) {
+            if (!_add_sstr_loc(alloc, &sub_strings, &substr_space, p, ++needles_found)) {
+                _str_free(alloc, sub_strings);                      // No partial results: failure is always NULL
+                return NULL;
+            }
+        }
+    }
+    return sub_strings;
+}
+
+/* *************************************************************************************************************************
+ * strAllStrWith - String substring search - All locations - Finds all substring locations in 'str' and saves them to a
+ * NULL terminated array of pointers allocated from 'alloc' (release it with strFreeWith). The array is empty if there
+ * are none. Returns NULL, with alloc->error set, if memory runs out
+ * *************************************************************************************************************************/
+
+inline char **strAllStrWith(StrAllocator *alloc, char *str, char *sub) {
+    return _all_str(alloc, str, sub, false);
+}
+
 
 /* *************************************************************************************************************************
- * strAllStr - String substring search - All locations - Finds all substring locations in 'str' and saves locations to
- * an array of pointers. Returns first pointer in array
+ * strCaseAllStrWith - String substring search - Case insensitive - All locations - strAllStrWith ignoring case
+ * *************************************************************************************************************************/
+
+inline char **strCaseAllStrWith(StrAllocator *alloc, char *str, char *sub) {
+    return _all_str(alloc, str, sub, true);
+}
+
+
+/* *************************************************************************************************************************
+ * strAllStr - String substring search - All locations - strAllStrWith using malloc. The array must be freed. Returns
+ * NULL and sets errno if memory runs out
  * *************************************************************************************************************************/
 
 inline char **strAllStr(char *str, char *sub) {
-    
-    enum {INITIAL, MATCH, MISMATCH} state = INITIAL;
-    register size_t idx = 0, matched = 0, needles_found = 0, substr_space = 5;
-    char **sub_strings = NULL;
-    
-    while (str[idx]) {
-        switch (state) {
-            case INITIAL:                                       // Initial State <=> If match is found, increment matched. Set state accordingly
-                if (str[idx] == sub[matched] && ++matched)
-                    state = MATCH;
-                else state = MISMATCH;
-            break;
-            case MATCH:                                         // Match State <=> If current element not a match, set matched = 0. Otherwise, see if entire substring has been matched.
-                if (str[idx] != sub[matched] && sub[matched]) {        // Second part of conditional added to handle length 1 substrings. If removed, substrings with len > 1 will be matched.
-                    state = MISMATCH, matched = 0;
-                } else if (!sub[matched++] || !sub[matched]) {         // This condition has also been modified to account for len 1 substrings, does not work for them if written as 'if (!sub[++matched])'
-                    _add_sstr_loc(sub_strings, &str[idx-matched+1], ++needles_found);
-                    state = MISMATCH, matched = 0;
-                }
-            break;
-            case MISMATCH:                                      // Mismatch State <=> If the current element is a match, increment matched. Set state accordingly.
-                if (str[idx] == sub[matched] && ++matched)
-                    state = MATCH;
-            break;
-        }
-        ++idx;
-    }
-    return substr_space != needles_found ? realloc(sub_strings, (needles_found+1) * sizeof(char *)) : sub_strings;
+    StrAllocator alloc = STRALLOCATOR_DEFAULT;
+    char **all = _all_str(&alloc, str, sub, false);
+    if (alloc.error) errno = alloc.error;
+    return all;
 }
 
 
 /* *************************************************************************************************************************
- * strCaseAllStr - String substring search - Case insensitive - All locations - Finds all substring locations in 'str' 
- * and saves locations to an array of pointers. Returns first pointer in array
+ * strCaseAllStr - String substring search - Case insensitive - All locations - strCaseAllStrWith using malloc. Returns
+ * NULL and sets errno if memory runs out
  * *************************************************************************************************************************/
 
 inline char **strCaseAllStr(char *str, char *sub) {
-    
-    enum {INITIAL, MATCH, MISMATCH} state = INITIAL;
-    register size_t idx = 0, matched = 0, needles_found = 0, substr_space = 5;
-    char **sub_strings = NULL;
-    
-    while (str[idx]) {
-        switch (state) {
-            case INITIAL:
-                if (lc(str[idx])==lc(sub[matched]) && ++matched)
-                    state = MATCH;
-                 else state = MISMATCH;
-            break;
-            case MATCH:
-                if (lc(str[idx]) != lc(sub[matched]) && sub[matched]) {
-                    state = MISMATCH, matched = 0;
-                } else if (!sub[matched++] || !sub[matched]) {
-                    _add_sstr_loc(sub_strings, &str[idx-matched+1], ++needles_found);
-                    state = MISMATCH, matched = 0;
-                }
-            break;
-            case MISMATCH:
-                if (lc(str[idx])==lc(sub[matched]) && ++matched)
-                    state = MATCH;
-            break;
-        }
-        ++idx;
-    }
-    return substr_space != needles_found+1 ? realloc(sub_strings, (needles_found+1) * sizeof(char *)) : sub_strings;
+    StrAllocator alloc = STRALLOCATOR_DEFAULT;
+    char **all = _all_str(&alloc, str, sub, true);
+    if (alloc.error) errno = alloc.error;
+    return all;
+}
+
+
+/* *************************************************************************************************************************
+ * strFreeWith - Releases memory returned by one of the ...With functions through the allocator it came from
+ * *************************************************************************************************************************/
+
+inline void strFreeWith(StrAllocator *alloc, void *ptr) {
+    _str_free(alloc, ptr);
 }
 
 
+#if defined(__SSE2__)
+
+/* =========================================================================================================================
+ * _simd_reverse - Reverses the byte order of a 16 character block using SSE2 only: swap the 32-bit lanes, then the
+ * 16-bit halves of each lane, then the bytes of each half
+ * ========================================================================================================================*/
+
+static inline __m128i _simd_reverse(__m128i v) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+#endif
+
+/* =========================================================================================================================
+ * _is_pal - Palindrome check shared by strIsPal and strCaseIsPal. Compares the string against itself from both ends in
+ * place: a 16 character block from the front against the reversed block at the back, until the blocks would overlap,
+ * then character by character through the middle
+ * ========================================================================================================================*/
+
+static inline bool _is_pal(const char *str, bool fold) {
+    size_t i = 0, j = strlen(str);                                 // Compare str[i] with str[j-1], moving inwards
+#if defined(__SSE2__)
+    for (; i + 32 <= j; i += 16, j -= 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)&str[i]), b = _simd_reverse(_mm_loadu_si128((const __m128i *)&str[j-16]));
+        if (fold) a = _simd_lc(a), b = _simd_lc(b);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) return false;
+    }
+#endif
+    if (fold) {
+        for (; i + 1 < j && lc(str[i]) == lc(str[j-1]); ++i, --j);
+    } else {
+        for (; i + 1 < j && str[i] == str[j-1]; ++i, --j);
+    }
+    return i + 1 >= j;
+}
+
 /* *************************************************************************************************************************
  * strIsPal - String is palindrome - Determines whether string is a palindrome or not
  * *************************************************************************************************************************/
 
 inline bool strIsPal(const char *str) {
-    size_t n = strLen_((char *)str);
-    char end[(n/2)+1];
-    for (char *mid = (char *)str + (n/2) - !(n%2), *s1 = end, *s2 = (char *)str + n - 1; s2 > mid; *s1++ = *s2--);
-    return (n < 2 || !strnCmp_(end,str,n/2)) ? true : false;
+    return _is_pal(str, false);
 }
 
 
-
 /* *************************************************************************************************************************
  * strCaseIsPal - String is palindrome - Case insensitive - Determines whether string is a palindrome or not
  * *************************************************************************************************************************/
 
 inline bool strCaseIsPal(const char *str) {
-    size_t n = strLen_((char *)str);
-    char end[(n/2)+1];
-    for (char *mid = (char *)str + (n/2) - !(n%2), *s1 = end, *s2 = (char *)str + n - 1; s2 > mid; *s1++ = *s2--);
-    return (n < 2 || !strnCaseCmp_(end,str,n/2)) ? true : false;
+    return _is_pal(str, true);
 }
 
 
+/* =========================================================================================================================
+ * _splice - Replaces s1[idx, idx + del) with the n2 characters at s2, given n1 = length of s1. The tail (NUL included) is
+ * shifted into place with one overlapping move, then s2 is copied into the gap. The caller checks the capacity
+ * ========================================================================================================================*/
+
+static inline char *_splice(char *s1, size_t n1, size_t idx, size_t del, const char *s2, size_t n2) {
+    if (idx > n1) idx = n1;                                         // Past the end appends
+    if (del > n1 - idx) del = n1 - idx;
+    memmove(s1 + idx + n2, s1 + idx + del, n1 - idx - del + 1);
+    memcpy(s1 + idx, s2, n2);
+    return s1;
+}
+
 /* *************************************************************************************************************************
- * strInsert - String insert - Inserts s2 into s1 at the provided index idx
+ * strInsert - String insert - Inserts s2 into s1 at the provided index idx (at the end if idx is past it). s1 must have
+ * room for the result. Use strnInsert when the buffer size is known
  * *************************************************************************************************************************/
 
 inline char *strInsert(char *s1, const char *s2, size_t idx) {
-    char *p1, *p2;
-    for (p1 = s1; *p1 && *++p1; ++p1);                                                          // Loop until last element in s1
-    for (p2 = (char*)s2; *p2 && *++p2; ++p2);                                                   // Loop until last element in s2
-    size_t n1 = (size_t)(p1 - s1), n2 = (size_t)(p2 - s2);                                      // n1 = length s1, n2 = length s2
-    for (p1 = &s1[n1 + n2 - 1], p2 = &s1[n1 - 1], *p1 = *p2; p2 > &s1[idx]; *--p1 = *--p2);     // Shift s1 backwards until insertion index is reached
-    for (p1 = &s1[idx], *p1 = *s2; p1 < &s1[idx] + n2 - 1; *++p1 = *++s2);                      // Copy s2 into s1 starting at the insertion index
+    return _splice(s1, strlen(s1), idx, 0, s2, strlen(s2));
+}
+
+
+/* *************************************************************************************************************************
+ * strnInsert - String insert - Bounded - Inserts s2 into s1 at index idx if the result fits in cap bytes
+ * *************************************************************************************************************************/
+
+inline char *strnInsert(char *s1, size_t cap, const char *s2, size_t idx) {
+    return strSplice(s1, cap, idx, 0, s2);
+}
+
+
+/* *************************************************************************************************************************
+ * strSplice - String splice - Replaces the del characters of s1 starting at idx with s2 (del = 0 inserts, an empty s2
+ * deletes) if the result fits in cap bytes
+ * *************************************************************************************************************************/
+
+inline char *strSplice(char *s1, size_t cap, size_t idx, size_t del, const char *s2) {
+    size_t n1 = strnlen(s1, cap), n2 = strlen(s2);
+    if (n1 == cap) return NULL;                                     // Not terminated within its buffer
+    if (idx > n1) idx = n1;
+    if (del > n1 - idx) del = n1 - idx;
+    if (n2 > cap - 1 - (n1 - del)) return NULL;
+    return _splice(s1, n1, idx, del, s2, n2);
+}
+
+
+/* *************************************************************************************************************************
+ * strInsertAll - String insert - Multiple fragments - Inserts every fragment into s1 in a single pass, for templating.
+ * Fragment indices refer to the original s1 and must be in non-decreasing order (fragments at the same index keep their
+ * array order). Working from the back, each character of s1 moves once, straight to its final position. Returns NULL if
+ * the indices are out of order or past the end of s1
+ * *************************************************************************************************************************/
+
+inline char *strInsertAll(char *s1, size_t cap, const StrFragment *frags, size_t n) {
+    size_t n1 = strnlen(s1, cap), total = 0;
+    if (n1 == cap) return NULL;
+    for (size_t k = 0; k < n; ++k) {
+        if (frags[k].idx > n1 || (k && frags[k].idx < frags[k-1].idx)) return NULL;
+        total += strlen(frags[k].str);
+        if (total > cap - 1 - n1) return NULL;
+    }
+
+    size_t end = n1, out = n1 + total;
+    s1[out] = '\0';
+    for (size_t k = n; k--; ) {
+        size_t idx = frags[k].idx, m = strlen(frags[k].str);
+        out -= end - idx;
+        memmove(s1 + out, s1 + idx, end - idx);                    // Segment between this fragment and the next one
+        out -= m;
+        memcpy(s1 + out, frags[k].str, m);
+        end = idx;
+    }
     return s1;
 }
 
 
+/* =========================================================================================================================
+ * _Match - One replacement found by the replace functions: replace str[pos, pos + del) with rep[0, rep_len)
+ * ========================================================================================================================*/
+
+typedef struct {
+    size_t pos, del;
+    const char *rep;
+    size_t rep_len;
+} _Match;
+
+static inline bool _add_match(StrAllocator *alloc, _Match **matches, size_t *count, size_t *space, _Match match) {
+    if (*count == *space) {
+        size_t grown = *space ? *space * 2 : 16;
+        _Match *tmp = _str_alloc(alloc, *matches, grown * sizeof(_Match));
+        if (!tmp) return false;
+        *matches = tmp, *space = grown;
+    }
+    (*matches)[(*count)++] = match;
+    return true;
+}
+
+/* =========================================================================================================================
+ * _apply_matches - Writes str with every match replaced into a new buffer of exactly out_len + 1 bytes. Each unmatched
+ * run and each replacement is copied once
+ * ========================================================================================================================*/
+
+static char *_apply_matches(StrAllocator *alloc, const char *str, size_t n, const _Match *matches, size_t count,
+                            size_t out_len) {
+    char *out = _str_alloc(alloc, NULL, out_len + 1), *w = out;
+    if (!out) return NULL;
+    size_t from = 0;
+    for (size_t k = 0; k < count; ++k) {
+        memcpy(w, str + from, matches[k].pos - from), w += matches[k].pos - from;
+        memcpy(w, matches[k].rep, matches[k].rep_len), w += matches[k].rep_len;
+        from = matches[k].pos + matches[k].del;
+    }
+    memcpy(w, str + from, n - from + 1);                            // Rest of str and its NUL
+    return out;
+}
+
+/* =========================================================================================================================
+ * _replace_all - strReplaceAllWith / strCaseReplaceAllWith. One scan records the matches and sizes the output exactly, a second
+ * pass over the recorded matches writes it
+ * ========================================================================================================================*/
+
+static char *_replace_all(StrAllocator *alloc, const char *str, const char *needle, const char *rep, size_t *count, bool fold) {
+    size_t n = strlen(str), m = strlen(needle), r = strlen(rep), found = 0, space = 0, out_len = n;
+    _Match *matches = NULL;
+    if (m) {
+        for (const char *p = str; (p = _find(p, n - (size_t)(p - str), needle, m, fold)); p += m) {
+            if (!_add_match(alloc, &matches, &found, &space, (_Match){ (size_t)(p - str), m, rep, r })) {
+                _str_free(alloc, matches);
+                return NULL;
+            }
+            out_len = out_len - m + r;
+        }
+    }
+    char *out = _apply_matches(alloc, str, n, matches, found, out_len);
+    _str_free(alloc, matches);
+    if (out && count) *count = found;
+    return out;
+}
+
+/* *************************************************************************************************************************
+ * strReplaceAllWith - String replace - All occurrences - Returns a new string allocated from 'alloc' with every
+ * occurrence of needle in str replaced by rep. Returns NULL, with alloc->error set, if memory runs out
+ * *************************************************************************************************************************/
+
+inline char *strReplaceAllWith(StrAllocator *alloc, const char *str, const char *needle, const char *rep, size_t *count) {
+    return _replace_all(alloc, str, needle, rep, count, false);
+}
+
+
+/* *************************************************************************************************************************
+ * strCaseReplaceAllWith - String replace - Case insensitive - All occurrences - strReplaceAllWith with needle matched
+ * ignoring case. rep is inserted as given
+ * *************************************************************************************************************************/
+
+inline char *strCaseReplaceAllWith(StrAllocator *alloc, const char *str, const char *needle, const char *rep,
+                                   size_t *count) {
+    return _replace_all(alloc, str, needle, rep, count, true);
+}
+
+
+/* *************************************************************************************************************************
+ * strReplaceAll / strCaseReplaceAll - The ...With versions using malloc. The result must be freed. Return NULL and set
+ * errno if memory runs out
+ * *************************************************************************************************************************/
+
+inline char *strReplaceAll(const char *str, const char *needle, const char *rep, size_t *count) {
+    StrAllocator alloc = STRALLOCATOR_DEFAULT;
+    char *out = _replace_all(&alloc, str, needle, rep, count, false);
+    if (alloc.error) errno = alloc.error;
+    return out;
+}
+
+inline char *strCaseReplaceAll(const char *str, const char *needle, const char *rep, size_t *count) {
+    StrAllocator alloc = STRALLOCATOR_DEFAULT;
+    char *out = _replace_all(&alloc, str, needle, rep, count, true);
+    if (alloc.error) errno = alloc.error;
+    return out;
+}
+
+
+/* *************************************************************************************************************************
+ * strReplaceAllInPlace - String replace - All occurrences - In place - strReplaceAll written over str, which only works
+ * when rep is no longer than needle: the write position then never passes the read position, so one forward pass with
+ * no extra memory suffices. Returns NULL (str unchanged) if rep is longer than needle
+ * *************************************************************************************************************************/
+
+inline char *strReplaceAllInPlace(char *str, const char *needle, const char *rep, size_t *count) {
+    size_t n = strlen(str), m = strlen(needle), r = strlen(rep), found = 0;
+    if (r > m) return NULL;
+    char *w = str, *from = str;
+    if (m) {
+        for (char *p; (p = (char *)_find(from, n - (size_t)(from - str), needle, m, false)); from = p + m, ++found) {
+            memmove(w, from, (size_t)(p - from)), w += p - from;
+            memcpy(w, rep, r), w += r;
+        }
+    }
+    memmove(w, from, n - (size_t)(from - str) + 1);
+    if (count) *count = found;
+    return str;
+}
+
+
+/* *************************************************************************************************************************
+ * strReplaceTableWith - String replace - Multiple patterns - Returns a new string allocated from 'alloc' with every
+ * needle in the table replaced by its rep, in one scan of str. Where several needles match at the same position, the
+ * first one in the table wins, so list longer needles before their prefixes. Replacements are not rescanned. Returns
+ * NULL, with alloc->error set, if memory runs out
+ * *************************************************************************************************************************/
+
+inline char *strReplaceTableWith(StrAllocator *alloc, const char *str, const StrReplacement *table, size_t n, size_t *count) {
+    size_t len = strlen(str), found = 0, space = 0, out_len = len, first[EXTENDED_ASCII_RANGE];
+    size_t *next = _str_alloc(alloc, NULL, 2 * (n ? n : 1) * sizeof(size_t)), *lens = next + (n ? n : 1);
+    _Match *matches = NULL;
+    char *out = NULL;
+    if (!next) return NULL;
+
+    // Chain the entries by first character, in table order, so each position only tries needles that can match there
+    for (size_t c = 0; c < EXTENDED_ASCII_RANGE; ++c) first[c] = SIZE_MAX;
+    for (size_t e = n; e--; ) {
+        if (!(lens[e] = strlen(table[e].needle))) continue;
+        unsigned char c = (unsigned char)table[e].needle[0];
+        next[e] = first[c], first[c] = e;
+    }
+
+    for (size_t i = 0; i < len; ) {
+        size_t e = first[(unsigned char)str[i]];
+        for (; e != SIZE_MAX; e = next[e])
+            if (lens[e] <= len - i && !memcmp(str + i, table[e].needle, lens[e])) break;
+        if (e == SIZE_MAX) {
+            ++i;
+            continue;
+        }
+        size_t r = strlen(table[e].rep);
+        if (!_add_match(alloc, &matches, &found, &space, (_Match){ i, lens[e], table[e].rep, r })) goto done;
+        out_len = out_len - lens[e] + r, i += lens[e];
+    }
+    if ((out = _apply_matches(alloc, str, len, matches, found, out_len)) && count) *count = found;
+
+done:
+    _str_free(alloc, next), _str_free(alloc, matches);
+    return out;
+}
+
+
+/* *************************************************************************************************************************
+ * strReplaceTable - strReplaceTableWith using malloc. The result must be freed. Returns NULL and sets errno if memory
+ * runs out
+ * *************************************************************************************************************************/
+
+inline char *strReplaceTable(const char *str, const StrReplacement *table, size_t n, size_t *count) {
+    StrAllocator alloc = STRALLOCATOR_DEFAULT;
+    char *out = strReplaceTableWith(&alloc, str, table, n, count);
+    if (alloc.error) errno = alloc.error;
+    return out;
+}
+
+
+/* =========================================================================================================================
+ * _histogram - Byte histogram kernel - Adds the counts of the n bytes at s to counts. Bytes are counted 8 at a time, each
+ * into its own 16-bit sub-histogram, so runs of equal bytes land in different tables and don't stall waiting on the
+ * previous increment's store. The narrow counters are flushed into counts before any of them can overflow. Short inputs
+ * are counted straight into counts: clearing the 4KB of sub-tables and summing them back costs more than the stalls save
+ * ========================================================================================================================*/
+
+#define _HISTOGRAM_ROUND (8 * 65535)
+#define _HISTOGRAM_SMALL 384            // Measured: the sub-tables win from ~450 bytes (few letters) to ~640 (random bytes)
+
+static inline void _histogram(const unsigned char *s, size_t n, size_t *counts) {
+    if (n < _HISTOGRAM_SMALL) {
+        for (size_t i = 0; i < n; ++i) ++counts[s[i]];
+        return;
+    }
+    uint16_t sub[8][EXTENDED_ASCII_RANGE];
+    while (n) {
+        size_t round = n < _HISTOGRAM_ROUND ? n : _HISTOGRAM_ROUND, i = 0;
+        memset(sub, 0, sizeof(sub));
+        for (uint64_t w; i + 8 <= round; i += 8) {              // Each table gets 1 byte per word: 65535 words max per round
+            memcpy(&w, s + i, 8);
+            ++sub[0][(uint8_t)w], ++sub[1][(uint8_t)(w >> 8)], ++sub[2][(uint8_t)(w >> 16)], ++sub[3][(uint8_t)(w >> 24)];
+            ++sub[4][(uint8_t)(w >> 32)], ++sub[5][(uint8_t)(w >> 40)], ++sub[6][(uint8_t)(w >> 48)], ++sub[7][w >> 56];
+        }
+        for (; i < round; ++i) ++sub[i & 7][s[i]];
+        for (unsigned int c = 0; c < EXTENDED_ASCII_RANGE; ++c) {
+            counts[c] += (size_t)sub[0][c] + sub[1][c] + sub[2][c] + sub[3][c] + sub[4][c] + sub[5][c] + sub[6][c] + sub[7][c];
+        }
+        s += round, n -= round;
+    }
+}
+
+/* *************************************************************************************************************************
+ * strHistogram - String histogram - Sets counts[c] to the number of occurrences of each character c (indexed as unsigned
+ * char) in str. counts must hold EXTENDED_ASCII_RANGE entries. Returns the length of str
+ * *************************************************************************************************************************/
+
+inline size_t strHistogram(const char *str, size_t *counts) {
+    size_t n = strlen(str);
+    memset(counts, 0, EXTENDED_ASCII_RANGE * sizeof(*counts));
+    _histogram((const unsigned char *)str, n, counts);
+    return n;
+}
+
+/* *************************************************************************************************************************
+ * strCaseHistogram - String histogram - Case insensitive - Same as strHistogram, but uppercase letters are counted as
+ * their lowercase equivalents
+ * *************************************************************************************************************************/
+
+inline size_t strCaseHistogram(const char *str, size_t *counts) {
+    size_t n = strHistogram(str, counts);
+    for (unsigned int c = 'A'; c <= 'Z'; ++c) {
+        counts[lc(c)] += counts[c], counts[c] = 0;
+    }
+    return n;
+}
+
 /* *************************************************************************************************************************
  * strIsPerm - String is permutation - Determines whether s1 and s2 are permutations
  * *************************************************************************************************************************/
 
 inline bool strIsPerm(const char *s1, const char *s2) {
     
-    // 256 buckets, one for each character. Initialize all buckets to 0
-    size_t b1_[EXTENDED_ASCII_RANGE] = {0}, b2_[EXTENDED_ASCII_RANGE] = {0};
-
-    // Count the occurance for each character in s1 and s2. Continue iterating until a null character is reached in either string
-    while (*s1 && *s2 && ++b1_[*s1++] && ++b2_[*s2++]);
-    
     // If the strings are of different length, return false
-    if (*s1 || *s2) return false;
-    
-    // Compare occurance counts for each character. Return false if a discrepency is encountered
-    for (unsigned int i = 0; i < EXTENDED_ASCII_RANGE; ++i) {
-        if (b1_[i] != b2_[i]) return false;
-    }
+    size_t n = strlen(s1);
+    if (strlen(s2) != n) return false;
     
-    return true;
+    // Count the occurance for each character in s1 and s2, then compare the counts
+    size_t b1_[EXTENDED_ASCII_RANGE] = {0}, b2_[EXTENDED_ASCII_RANGE] = {0};
+    _histogram((const unsigned char *)s1, n, b1_);
+    _histogram((const unsigned char *)s2, n, b2_);
+    return !memcmp(b1_, b2_, sizeof(b1_));
 }
 
 
@@ -461,42 +950,54 @@ inline bool strIsPerm(const char *s1, const char *s2) {
  * *************************************************************************************************************************/
 
 inline bool strCaseIsPerm(const char *s1, const char *s2) {
-    
-    // 256 buckets, one for each character. Initialize all buckets to 0
-    size_t b1_[EXTENDED_ASCII_RANGE] = {0}, b2_[EXTENDED_ASCII_RANGE] = {0};
-    
-    // Count the occurance for each character in s1 and s2. Continue iterating until a null character is reached in either string
-    for (; *s1 && *s2; ++s1, ++s2) {
-        ++b1_[lc(*s1)], ++b2_[lc(*s2)];
+    size_t b1_[EXTENDED_ASCII_RANGE], b2_[EXTENDED_ASCII_RANGE];
+    return strCaseHistogram(s1, b1_) == strCaseHistogram(s2, b2_) && !memcmp(b1_, b2_, sizeof(b1_));
+}
+
+/* =========================================================================================================================
+ * _insertion_sort - Sorts n characters by unsigned value. Used by strSort for tiny strings
+ * ========================================================================================================================*/
+
+static inline void _insertion_sort(unsigned char *s, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        unsigned char v = s[i];
+        size_t j = i;
+        for (; j && s[j-1] > v; --j) s[j] = s[j-1];
+        s[j] = v;
     }
-    
-    // If the strings are of different length, return false
-    if (*s1 || *s2) return false;
-    
-    // Compare occurance counts for each character. Return false if a discrepency is encountered
-    for (unsigned int i = 0; i < EXTENDED_ASCII_RANGE; ++i) {
-        if (b1_[i] != b2_[i]) return false;
-        
+}
+
+/* =========================================================================================================================
+ * _small_count_sort - Counting sort with a single 16-bit table, only walking the buckets between the smallest and largest
+ * character seen. Avoids strCountSort's fixed cost of clearing and summing 8 sub-histograms. Requires n <= 65535
+ * ========================================================================================================================*/
+
+static inline void _small_count_sort(unsigned char *s, size_t n) {
+    uint16_t counts[EXTENDED_ASCII_RANGE] = {0};
+    unsigned int lo = EXTENDED_ASCII_RANGE - 1, hi = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned int c = s[i];
+        ++counts[c], lo = c < lo ? c : lo, hi = c > hi ? c : hi;
+    }
+    for (unsigned int c = lo; c <= hi; s += counts[c++]) {
+        memset(s, (int)c, counts[c]);
     }
-    
-    return true;
 }
 
 /* *************************************************************************************************************************
- * strSort - String sort - Sorts string using bubble sort
+ * strSort - String sort - Sorts string in place by unsigned character value, picking the method by length:
+ * insertion sort up to STRSORT_INSERTION_MAX characters, a single-table counting sort up to STRSORT_SMALL_COUNT_MAX, and
+ * strCountSort (the bulk histogram kernel plus one fill pass) beyond that, which keeps large strings bandwidth bound.
+ * Returns false if the string is null or empty
  * *************************************************************************************************************************/
 
 inline bool strSort(char *str) {
-    for (char *p = *str ? str+1 : str, swap = 0; *p; ++p) {
-        for (char *q = str; *(q + (p-str)); ++q) {
-            if (*q > *(q+1)) {
-                _swap_iter(q,(q+1));
-                swap = 1;
-            }
-        }
-        if (!swap) break;
-    }
-    return str && *str ? true : false;
+    if (!str || !*str) return false;
+    size_t n = strlen(str);
+    if (n <= STRSORT_INSERTION_MAX) _insertion_sort((unsigned char *)str, n);
+    else if (n <= STRSORT_SMALL_COUNT_MAX) _small_count_sort((unsigned char *)str, n);
+    else strCountSort(str);
+    return true;
 }
 
 
@@ -505,41 +1006,42 @@ inline bool strSort(char *str) {
  * *************************************************************************************************************************/
 
 inline char *strCountSort(char *str) {
-    // Create array for character counts and initialize all buckets to 0
-    size_t counts[EXTENDED_ASCII_RANGE] = {0};
-    
-    // Iterate through str. For each occurence of given character, increment corresponding bucket
-    char *s;
-    for (s = str; *s; ) {
-        ++counts[*s++];
+    // Count the occurences of each character, then write each character back in order as one run per bucket
+    size_t counts[EXTENDED_ASCII_RANGE];
+    strHistogram(str, counts);
+    char *s = str;
+    for (unsigned int i = 0; i < EXTENDED_ASCII_RANGE; s += counts[i++]) {
+        memset(s, (int)i, counts[i]);
     }
-    s = str;
-    
-    // Iterate through buckets and save characters to str in order
-    for (unsigned int i = 0; i < EXTENDED_ASCII_RANGE; ++i) {
-        for (size_t j = 0; j < counts[i]; ++j, ++s) {
-            *s = (char)i;
-        }
-    }
-    
     return str;
 }
 
 
+/* =========================================================================================================================
+ * _bitset_test_set - Sets the bit for character c in a 256-bit set held as four 64-bit words. Returns true if the bit
+ * was already set
+ * ========================================================================================================================*/
+
+static inline bool _bitset_test_set(uint64_t *set, unsigned char c) {
+    uint64_t bit = (uint64_t)1 << (c & 63), seen = set[c >> 6] & bit;
+    set[c >> 6] |= bit;
+    return seen;
+}
+
 /* *************************************************************************************************************************
- * strHasDups - String has duplicates - Determines whether string has duplicates or not
+ * strHasDups - String has duplicates - Determines whether string has duplicates or not. Stops at the first repeat
  * *************************************************************************************************************************/
 
 inline bool strHasDups(char *str) {
-    // struct array holds 256 single bit buckets. Initialize all bits to unset
-    BitArray b_[EXTENDED_ASCII_RANGE] = {0};
-    // Iterate through each character in the string and toggle the corresponding bit. If the bit has been toggled more than once, return true
+    // 256 single bit buckets in four words. Initialize all bits to unset
+    uint64_t b_[EXTENDED_ASCII_RANGE / 64] = {0};
+    // Mark each character as seen. If it was already marked, it's a duplicate
     while (*str) {
-        if (~(b_[*str++].bit ^= 1)) {
+        if (_bitset_test_set(b_, (unsigned char)*str++)) {
             return true;
         }
     }
-    // Return false if no bits are toggled more than once (no duplicates exist)
+    // Return false if no character was seen more than once (no duplicates exist)
     return false;
 }
 
@@ -549,20 +1051,92 @@ inline bool strHasDups(char *str) {
  * *************************************************************************************************************************/
 
 inline bool strCaseHasDups(char *str) {
-    // struct array holds 256 single bit buckets. Initialize all bits to unset
-    BitArray b_[EXTENDED_ASCII_RANGE] = {0};
-    // Iterate through each character in the string and toggle the corresponding bit. If the bit has been toggled more than once, return true
+    uint64_t b_[EXTENDED_ASCII_RANGE / 64] = {0};
     while (*str) {
-        if (~(b_[lc(*str)].bit ^= 1)) {
+        if (_bitset_test_set(b_, (unsigned char)lc(*str))) {
             return true;
         } else ++str;
     }
-    // Return false if no bits are toggled more than once (no duplicates exist)
     return false;
 }
 
 /* *************************************************************************************************************************
- * strPermutateAll - String permutate all - Generates all permutations of str and outputs them to the provided stream
+ * strnHasDups - String has duplicates - Checks exactly n characters (NULs included), so str need not be NUL terminated
+ * *************************************************************************************************************************/
+
+inline bool strnHasDups(const char *str, size_t n) {
+    if (n > EXTENDED_ASCII_RANGE) return true;                     // More characters than distinct values
+    uint64_t b_[EXTENDED_ASCII_RANGE / 64] = {0};
+    for (size_t i = 0; i < n; ++i) {
+        if (_bitset_test_set(b_, (unsigned char)str[i])) return true;
+    }
+    return false;
+}
+
+/* *************************************************************************************************************************
+ * strnCaseHasDups - String has duplicates - Case insensitive - strnHasDups with A-Z folded to a-z
+ * *************************************************************************************************************************/
+
+inline bool strnCaseHasDups(const char *str, size_t n) {
+    if (n > EXTENDED_ASCII_RANGE) return true;
+    uint64_t b_[EXTENDED_ASCII_RANGE / 64] = {0};
+    for (size_t i = 0; i < n; ++i) {
+        if (_bitset_test_set(b_, (unsigned char)lc(str[i]))) return true;
+    }
+    return false;
+}
+
+/* *************************************************************************************************************************
+ * strHasDupsAll - String has duplicates - Checks each of n strings, storing the result for strs[i] in results[i] (NULL
+ * strings have no duplicates). Returns the number of strings that have duplicates
+ * *************************************************************************************************************************/
+
+inline size_t strHasDupsAll(char **strs, size_t n, bool *results) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) {
+        found += (results[i] = strs[i] && strHasDups(strs[i]));
+    }
+    return found;
+}
+
+/* *************************************************************************************************************************
+ * strCaseHasDupsAll - String has duplicates - Case insensitive - strHasDupsAll using strCaseHasDups
+ * *************************************************************************************************************************/
+
+inline size_t strCaseHasDupsAll(char **strs, size_t n, bool *results) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) {
+        found += (results[i] = strs[i] && strCaseHasDups(strs[i]));
+    }
+    return found;
+}
+
+/* =========================================================================================================================
+ * _next_permutation - Rearranges the n characters at 'first' into the next lexicographically greater permutation.
+ * Returns false once the last (descending) permutation has been reached. Repeated characters are handled natively:
+ * equal characters are never swapped with each other, so each distinct permutation is produced exactly once
+ * ========================================================================================================================*/
+
+static inline bool _next_permutation(unsigned char *first, size_t n) {
+    size_t i, j;
+    
+    // Find the longest non-increasing suffix. If it's the whole string, this is the last permutation
+    for (i = n > 1 ? n - 1 : 0; i > 0 && first[i-1] >= first[i]; --i);
+    if (i == 0) return false;
+    
+    // Swap the pivot with the rightmost character greater than it, then reverse the suffix into ascending order
+    for (j = n - 1; first[j] <= first[i-1]; --j);
+    unsigned char *p = &first[i-1], *q = &first[j];
+    _swap_iter(p, q);
+    for (p = &first[i], q = &first[n-1]; p < q; ++p, --q) _swap_iter(p, q);
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strPermutateAll - String permutate all - Generates all distinct permutations of str in lexicographic order and outputs
+ * them to the provided stream, one per line. Returns the number of permutations generated.
+ * Permutations are produced iteratively (no recursion) and collected in a buffer that is written with one fwrite per
+ * PERMUTATION_BUFFER_SIZE bytes, so large outputs are bound by I/O rather than per-line stdio calls
  * *************************************************************************************************************************/
 
 inline size_t strPermutateAll(char *str, FILE *stream) {
@@ -570,94 +1144,274 @@ inline size_t strPermutateAll(char *str, FILE *stream) {
     // Return false if the stream or string is null, or if the string is empty
     if (!stream || !str || !*str) return false;
     
-    // Save length of string, create array to hold permuted strings, define and initialize variable for permutation count
-    size_t n, permutation_count = 0;
-    char s[(n=strLen_(str)) + 1];
+    // Each output line is the permutation plus a newline. Size the buffer to a whole number of lines
+    size_t n = strLen(str), line = n + 1, used = 0, permutation_count = 0;
+    size_t space = line > PERMUTATION_BUFFER_SIZE ? line : PERMUTATION_BUFFER_SIZE - PERMUTATION_BUFFER_SIZE % line;
+    char *buffer = malloc(space), *s = malloc(line);
+    if (!buffer || !s) {
+        free(buffer), free(s);
+        return 0;
+    }
     
-    // Determine if the string contains duplicates and call the corresponding permutation function. Return the functions return value
-    return !strHasDups(str) ? _permutate_no_duplicates(strCpy_(s,str), n, stream, &permutation_count) : _permutate_has_duplicates(strCpy_(s,str), s, n, stream, &permutation_count);
-
+    // Start from the smallest permutation (sorted string) and step through the rest in order
+    strCountSort(strCpy_(s, str));
+    do {
+        if (used == space) fwrite(buffer, 1, used, stream), used = 0;
+        memcpy(buffer + used, s, n);
+        buffer[used + n] = '\n';
+        used += line, ++permutation_count;
+    } while (_next_permutation((unsigned char *)s, n));
+    
+    fwrite(buffer, 1, used, stream);
+    free(buffer), free(s);
+    return permutation_count;
 }
 
 /* =========================================================================================================================
- * _xor - XOR swap - Used by _permutate_no_duplicates
+ * _gcd - Greatest common divisor - Used by the permutation counting helpers
  * ========================================================================================================================*/
 
-#define _xor(a,b) (a != b ? a ^= b, b ^= a, a ^= b : a)
+static inline size_t _gcd(size_t a, size_t b) {
+    while (b) { size_t t = a % b; a = b; b = t; }
+    return a;
+}
 
 /* =========================================================================================================================
- * _xor_iter - XOR iterator swap - Used by _permutate_has_duplicates
+ * _count_permutations - Number of distinct permutations of a multiset given its character counts and size n:
+ * n! / (c1! * c2! * ...). Built up one binomial coefficient at a time. Returns 0 if the count doesn't fit in a size_t
  * ========================================================================================================================*/
 
-#define _xor_iter(a,b) (*a!=*b ? *a ^= *b, *b ^= *a, *a ^= *b : *a, a)
+static inline size_t _count_permutations(const size_t *counts, size_t n) {
+    size_t total = 1, placed = 0;
+    for (unsigned int c = 0; c < EXTENDED_ASCII_RANGE && placed < n; ++c) {
+        for (size_t j = 1; j <= counts[c]; ++j) {             // total *= C(placed + j, j) / C(placed + j - 1, j - 1)
+            size_t num = placed + j, den = j, g = _gcd(total, den);
+            total /= g, den /= g;                           // den now divides num exactly since the result is an integer
+            if (__builtin_mul_overflow(total, num / den, &total)) return 0;
+        }
+        placed += counts[c];
+    }
+    return total;
+}
 
 /* =========================================================================================================================
- * _min_element - Minimum element - Used by _permutate_has_duplicates
+ * _unrank_permutation - Writes the permutation of rank 'rank' (0 = sorted order) of the multiset described by 'counts'
+ * and n into 'out'. 'total' must be _count_permutations(counts, n). The number of permutations starting with character
+ * c is total * counts[c] / n, which is computed without overflow by dividing out the common factor first
  * ========================================================================================================================*/
 
-#define _min_element(a,b) ({                                                  \
-    char *q = a;                                                              \
-    for (char *p = q != b ? q+1 : b;   p != b;   q = *p < *q ? p : q, ++p);   \
-    q;                                                                        \
-})
+static inline void _unrank_permutation(const size_t *counts, size_t n, size_t total, size_t rank, unsigned char *out) {
+    size_t left[EXTENDED_ASCII_RANGE];
+    memcpy(left, counts, sizeof(left));
+    for (size_t rem = n; rem; --rem) {
+        for (unsigned int c = 0; c < EXTENDED_ASCII_RANGE; ++c) {
+            if (!left[c]) continue;
+            size_t g = _gcd(left[c], rem), block = total / (rem / g) * (left[c] / g);
+            if (rank < block) {
+                *out++ = (unsigned char)c, --left[c], total = block;
+                break;
+            }
+            rank -= block;
+        }
+    }
+}
+
+/* =========================================================================================================================
+ * _PermutationJob - Shared state for the strPermutateAllParallel workers. The permutation space is split by rank into
+ * fixed size chunks that workers claim in order. Chunks are written in rank order when 'ordered' is set, otherwise as
+ * soon as they're ready
+ * ========================================================================================================================*/
 
+typedef struct {
+    size_t counts[EXTENDED_ASCII_RANGE];    // Character counts of the input string
+    size_t n, total;                        // Length of the input and number of distinct permutations
+    size_t per_chunk, chunks;               // Permutations per chunk and number of chunks
+    size_t next_chunk, next_write;          // Next chunk to claim and (ordered output) next chunk to write
+    size_t written;                         // Number of permutations written to the stream
+    bool ordered, failed;
+    FILE *stream;
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+} _PermutationJob;
 
-/* *************************************************************************************************************************
- * _permutate_no_duplicates - Used by strPermutateAll - Permutation function for strings containing no duplicates. 
- * Returns the number of permutations generated.
- * *************************************************************************************************************************/
+/* =========================================================================================================================
+ * _permutate_worker - Claims chunks, unranks the first permutation of each and steps through the rest with
+ * _next_permutation into a thread-local buffer, then writes the whole chunk with a single fwrite
+ * ========================================================================================================================*/
 
-static inline size_t _permutate_no_duplicates(char *str, size_t n, FILE *stream, size_t *perm_count) {
+static void *_permutate_worker(void *arg) {
+    _PermutationJob *job = arg;
+    size_t n = job->n, line = n + 1, chunk;
+    char *buffer = malloc(job->per_chunk * line);
+    unsigned char *s = malloc(n);
+    
+    pthread_mutex_lock(&job->lock);
+    if (!buffer || !s) job->failed = true, pthread_cond_broadcast(&job->turn);
+    pthread_mutex_unlock(&job->lock);
     
-    // Permutate the string recursively by swapping the first and n-1 th element, passing n-1 as the new string length each call
-    if (n != 1) {
-        for (char *p = str; p < str + n; ++p) {
-            _xor(*p,str[n-1]), _permutate_no_duplicates(str,n-1,stream,perm_count), _xor(*p,str[n-1]);
+    while (buffer && s) {
+        pthread_mutex_lock(&job->lock);
+        chunk = !job->failed && job->next_chunk < job->chunks ? job->next_chunk++ : job->chunks;
+        pthread_mutex_unlock(&job->lock);
+        if (chunk == job->chunks) break;
+        
+        // Generate the chunk's permutations: [chunk * per_chunk, chunk * per_chunk + count)
+        size_t first = chunk * job->per_chunk, count = job->total - first < job->per_chunk ? job->total - first : job->per_chunk;
+        _unrank_permutation(job->counts, n, job->total, first, s);
+        for (size_t i = 0; i < count; ++i) {
+            memcpy(buffer + i * line, s, n);
+            buffer[i * line + n] = '\n';
+            _next_permutation(s, n);
         }
-    } else { // Print the permutations once they've all been generated (n = 1) and increment permutation for each one
-        fprintf(stream,"%s\n",str);
-        ++*perm_count;
+        
+        // Write it, waiting for the preceding chunk first if the output has to stay in rank order
+        pthread_mutex_lock(&job->lock);
+        while (job->ordered && job->next_write != chunk && !job->failed) pthread_cond_wait(&job->turn, &job->lock);
+        if (!job->failed) {
+            fwrite(buffer, 1, count * line, job->stream);
+            job->written += count, ++job->next_write;
+        }
+        pthread_cond_broadcast(&job->turn);
+        pthread_mutex_unlock(&job->lock);
     }
-    
-    // Return the number of permutations generated for the given string
-    return *perm_count;
+    free(buffer), free(s);
+    return NULL;
 }
 
 /* *************************************************************************************************************************
- * _permutate_has_duplicates - Used by strPermutateAll - Permutation function for strings containing duplicates.
- * Returns the number of permutations generated.
+ * strPermutateAllParallel - String permutate all - Parallel version of strPermutateAll. Splits the distinct permutations
+ * of str into rank ranges generated by 'threads' workers (0 = one per online processor). With 'ordered' set the output is
+ * identical to strPermutateAll, otherwise whole chunks may appear in any order. Returns the number of permutations
+ * written, which is less than the total only if a worker failed to allocate its buffer
  * *************************************************************************************************************************/
 
-static inline size_t _permutate_has_duplicates(char *str, char *start, size_t n, FILE *stream, size_t *perm_count) {
+inline size_t strPermutateAllParallel(char *str, FILE *stream, unsigned int threads, bool ordered) {
     
-    // Print the permutations to the provided stream and count each permutation by incrementing permutation count
-    if (n == 0) {
-        fprintf(stream,"%s\n",start);
-        ++*perm_count;
-        return 0;
-    }
+    // Return false if the stream or string is null, or if the string is empty
+    if (!stream || !str || !*str) return false;
     
-    // Find the minimum element within the given range: min ∈ [str, str + n]
-    char *min = _min_element(str,str+n), *next_min, *p;
+    _PermutationJob job = { .ordered = ordered, .stream = stream };
+    job.n = strHistogram(str, job.counts);
     
-    // Continue permutating recursively: swap 1st element & new minimum element, subtract 1 from length (n)
-    _permutate_has_duplicates(_xor_iter(str,min)+1, start, n-1, stream, perm_count);
+    // Permutation counts beyond a size_t can't be enumerated anyway
+    if (!(job.total = _count_permutations(job.counts, job.n))) return 0;
+    job.per_chunk = PERMUTATION_CHUNK_SIZE / (job.n + 1) ? PERMUTATION_CHUNK_SIZE / (job.n + 1) : 1;
+    job.chunks = job.total / job.per_chunk + !!(job.total % job.per_chunk);
     
-    // Find the minimum element that is greater than the 1st element: next_min ∈ [str + 1, str + n); next_min > str && next_min ≤ str + i  ∀i ∈ n
-    for (p = str+1, next_min = str+n; p < str + n; next_min = *p > *str && (next_min == str + n || *p < *next_min) ? p : next_min, ++p);
+    // One worker per processor by default, and never more workers than chunks
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (!threads) threads = online > 0 ? (unsigned int)online : 1;
+    if (threads > job.chunks) threads = (unsigned int)job.chunks;
     
-    // Loop continues iterating while a next_min character can be found
-    while (next_min != str + n) {
+    pthread_t workers[threads];
+    unsigned int started = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+    while (started < threads && !pthread_create(&workers[started], NULL, _permutate_worker, &job)) ++started;
+    if (!started) _permutate_worker(&job);                     // Couldn't start any threads, do the work on this one
+    for (unsigned int i = 0; i < started; ++i) pthread_join(workers[i], NULL);
+    pthread_cond_destroy(&job.turn);
+    pthread_mutex_destroy(&job.lock);
+    
+    return job.written;
+}
 
-        // Continue permutating recursively: swap 1st element & new minimum element, subtract 1 from length (n)
-        _permutate_has_duplicates(_xor_iter(str,next_min)+1, start, n-1, stream, perm_count);
-        
-        // Attempt to find the minimum element that is greater than the 1st element: next_min ∈ [str + 1, str + n), ∀i ∈ n, (next_min > str && next_min ≤ str + i)
-        for (p = str+1, next_min = str+n; p < str + n; next_min = *p > *str && (next_min == str + n || *p < *next_min) ? p : next_min, ++p);
+/* *************************************************************************************************************************
+ * strPermCount - String permutation count - Number of distinct permutations of str, computed from its character counts
+ * without enumerating them. If the count doesn't fit in a size_t, *overflow is set (when provided) and SIZE_MAX returned.
+ * Use strPermCountLog10 for the magnitude of counts that large
+ * *************************************************************************************************************************/
+
+inline size_t strPermCount(const char *str, bool *overflow) {
+    size_t counts[EXTENDED_ASCII_RANGE], n = strHistogram(str, counts), total;
+    total = _count_permutations(counts, n);
+    if (overflow) *overflow = !total;
+    return total ? total : SIZE_MAX;
+}
+
+/* *************************************************************************************************************************
+ * strPermCountLog10 - String permutation count - Base 10 logarithm of the number of distinct permutations of str.
+ * Never overflows: log10(n! / (c1! * c2! * ...)) is summed with lgamma
+ * *************************************************************************************************************************/
+
+inline double strPermCountLog10(const char *str) {
+    size_t counts[EXTENDED_ASCII_RANGE], n = strHistogram(str, counts);
+    double ln = lgamma((double)n + 1);
+    for (unsigned int c = 0; c < EXTENDED_ASCII_RANGE; ++c) {
+        if (counts[c] > 1) ln -= lgamma((double)counts[c] + 1);
+    }
+    return ln / log(10);
+}
+
+/* *************************************************************************************************************************
+ * strPermRank - String permutation rank - Position of str in the lexicographic order (by unsigned char value) of the
+ * distinct permutations of its characters, starting at 0 for the sorted string. Runs in O(n * alphabet) time and constant
+ * memory. Sets *overflow (when provided) and returns SIZE_MAX if the permutation count doesn't fit in a size_t
+ * *************************************************************************************************************************/
+
+inline size_t strPermRank(const char *str, bool *overflow) {
+    size_t counts[EXTENDED_ASCII_RANGE], n = strHistogram(str, counts), rank = 0, total;
+    if (overflow) *overflow = false;
+    if (!(total = _count_permutations(counts, n))) {
+        if (overflow) *overflow = true;
+        return SIZE_MAX;
     }
     
-    // Return the number of permutations generated for the given string
-    return *perm_count;
+    // At each position, skip over every permutation that starts with a smaller character still available
+    for (size_t rem = n; rem; --rem, ++str) {
+        unsigned char ch = (unsigned char)*str;
+        for (unsigned int c = 0; c < ch; ++c) {
+            if (!counts[c]) continue;
+            size_t g = _gcd(counts[c], rem);
+            rank += total / (rem / g) * (counts[c] / g);
+        }
+        size_t g = _gcd(counts[ch], rem);
+        total = total / (rem / g) * (counts[ch] / g), --counts[ch];
+    }
+    return rank;
+}
+
+/* *************************************************************************************************************************
+ * strPermUnrank - String permutation unrank - Rearranges str in place into the distinct permutation of its characters with
+ * the given rank (see strPermRank). Returns false and leaves str unchanged if rank is out of range or the permutation
+ * count doesn't fit in a size_t
+ * *************************************************************************************************************************/
+
+inline bool strPermUnrank(char *str, size_t rank) {
+    size_t counts[EXTENDED_ASCII_RANGE], n = strHistogram(str, counts), total;
+    if (!(total = _count_permutations(counts, n)) || rank >= total) return false;
+    _unrank_permutation(counts, n, total, rank, (unsigned char *)str);
+    return true;
+}
+
+/* =========================================================================================================================
+ * _rand_below - Uniform random integer in [0, bound) from rand(). Rejects the top partial range to avoid modulo bias
+ * ========================================================================================================================*/
+
+static inline size_t _rand_below(size_t bound) {
+    size_t r, range = (size_t)RAND_MAX + 1;
+    if (bound > range) {                                           // Wider than rand(): combine two draws
+        size_t hi = _rand_below(bound / range + 1);
+        return (r = hi * range + (size_t)rand()) < bound ? r : _rand_below(bound);
+    }
+    size_t limit = range - range % bound;
+    while ((r = (size_t)rand()) >= limit);
+    return r % bound;
+}
+
+/* *************************************************************************************************************************
+ * strPermShuffle - String permutation shuffle - Rearranges str in place into a uniformly random distinct permutation of
+ * its characters (Fisher-Yates). Each distinct permutation is equally likely even when characters repeat. Uses rand(),
+ * so seed with srand first
+ * *************************************************************************************************************************/
+
+inline char *strPermShuffle(char *str) {
+    size_t n = strLen(str);
+    for (char *p = str + n, *q; n > 1; --n) {
+        --p, q = str + _rand_below(n);
+        _swap_iter(p, q);
+    }
+    return str;
 }
 
 /* *************************************************************************************************************************
@@ -666,13 +1420,10 @@ static inline size_t _permutate_has_duplicates(char *str, char *start, size_t n,
  * *************************************************************************************************************************/
 
 inline bool strCharCounts(char *str, FILE *stream) {
-    size_t counts[EXTENDED_ASCII_RANGE] = {0};
-    bool ret;
-    
-    for (ret = str && *str ? true : false; ret && *str; ) {
-        ++counts[*str++];
-    }
+    size_t counts[EXTENDED_ASCII_RANGE];
+    bool ret = str && *str ? true : false;
     
+    if (ret) strHistogram(str, counts);
     for (unsigned int i = 0; ret && i < EXTENDED_ASCII_RANGE; ++i) {
         if (counts[i]) fprintf(stream,"%c: %lu\n",(char)i,counts[i]);
     }
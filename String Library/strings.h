@@ -71,10 +71,6 @@
 
 #define EXTENDED_ASCII_RANGE 256
 
-typedef struct {
-    int bit:1;
-} BitArray;
-
 #define uc(s) (s > 0x60 && s < 0x7b ? s&0x5F : s)
 #define toUpper(s) us(s)
 
@@ -96,10 +92,20 @@ extern inline char *strLwr(char *str);
 
 
 /* *************************************************************************************************************************/
-#define strLen_(str) ({                   \
-    char *s;                              \
-    for (s = str; *s && *++s; ++s);       \
-    s-str;                                \
+// No macro versions
+
+extern inline char *strnUpr(char *str, size_t n);
+extern inline char *strnLwr(char *str, size_t n);
+extern inline size_t strUprAll(char **strs, size_t n);
+extern inline size_t strLwrAll(char **strs, size_t n);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+#define strLen_(str) ({                 \
+    const char *b_ = (str), *e_ = b_;   \
+    while (*e_) ++e_;                   \
+    (size_t)(e_ - b_);                  \
 })
 
 extern inline size_t strLen(const char *str);
@@ -107,10 +113,10 @@ extern inline size_t strLen(const char *str);
 
 
 /* *************************************************************************************************************************/
-#define strCmp_(s1, s2) ({                                      \
-    register size_t i;                                          \
-    for (i = 0; s1[i] == s2[i] && s1[i]; ++i);                  \
-    (int)(s1[i]-s2[i]);                                         \
+#define strCmp_(s1, s2) ({                                  \
+    register size_t i;                                      \
+    for (i = 0; s1[i] == s2[i] && s1[i]; ++i);              \
+    (int)((unsigned char)s1[i] - (unsigned char)s2[i]);     \
 })
 
 extern inline int strCmp(const char *s1, const char *s2);
@@ -118,10 +124,10 @@ extern inline int strCmp(const char *s1, const char *s2);
 
 
 /* *************************************************************************************************************************/
-#define strCaseCmp_(s1, s2) ({                             \
-    register size_t i;                                     \
-    for (i = 0; lc(s1[i]) == lc(s2[i]) && s1[i]; ++i);     \
-    (int)(lc(s1[i])-lc(s2[i]));                            \
+#define strCaseCmp_(s1, s2) ({                                          \
+    register size_t i;                                                  \
+    for (i = 0; lc(s1[i]) == lc(s2[i]) && s1[i]; ++i);                  \
+    (int)((unsigned char)lc(s1[i]) - (unsigned char)lc(s2[i]));         \
 })
 
 extern inline int strCaseCmp(const char *s1, const char *s2);
@@ -129,10 +135,10 @@ extern inline int strCaseCmp(const char *s1, const char *s2);
 
 
 /* *************************************************************************************************************************/
-#define strnCmp_(s1, s2, n) ({                             \
-    register long int i;                                   \
-    for (i = 0; i < n && s1[i] && s1[i]==s2[i]; ++i);      \
-    (int)(s1[i]-s2[i]);                                    \
+#define strnCmp_(s1, s2, n) ({                                          \
+    register long int i;                                                \
+    for (i = 0; i < n && s1[i] && s1[i]==s2[i]; ++i);                   \
+    i < n ? (int)((unsigned char)s1[i] - (unsigned char)s2[i]) : 0;     \
 })
 
 extern inline int strnCmp(const char *s1, const char *s2, long int n);
@@ -140,10 +146,10 @@ extern inline int strnCmp(const char *s1, const char *s2, long int n);
 
 
 /* *************************************************************************************************************************/
-#define strnCaseCmp_(s1, s2, n) ({                              \
-    register long int i;                                        \
-    for (i = 0; i < n && s1[i] && lc(s1[i])==lc(s2[i]); ++i);   \
-    (int)(lc(s1[i])-lc(s2[i]));                                 \
+#define strnCaseCmp_(s1, s2, n) ({                                              \
+    register long int i;                                                        \
+    for (i = 0; i < n && s1[i] && lc(s1[i])==lc(s2[i]); ++i);                   \
+    i < n ? (int)((unsigned char)lc(s1[i]) - (unsigned char)lc(s2[i])) : 0;     \
 })
 
 extern inline int strnCaseCmp(const char *s1, const char *s2, long int n);
@@ -193,6 +199,9 @@ extern inline ptrdiff_t strnCaseCpy(char *restrict dest, const char *restrict so
 
 
 /* *************************************************************************************************************************/
+// strCat, strCaseCat, strCharCat and strCaseCharCat assume dest is large enough. See strbuilder.h for a capacity aware
+// alternative when the final size isn't known
+
 #define strCat_(dest, src) ({                           \
     register size_t i, j;                               \
     for (i = 0; dest[i]; ++i);                          \
@@ -217,7 +226,11 @@ extern inline ptrdiff_t strCaseCat(char *restrict dest, const char *restrict sou
 
 
 /* *************************************************************************************************************************/
-#define strCharCat_(dest, src) ({ for (char *s = !dest ? NULL : *dest ? dest + 1 : dest; s && (*s || (!(*s = src) && src)); ++s); dest; })
+#define strCharCat_(dest, src) ({                                            \
+    char *d_ = (dest), c_ = (src), *e_ = d_;                                    \
+    if (d_ && c_) { while (*e_) ++e_; e_[0] = c_, e_[1] = '\0'; }               \
+    d_;                                                                         \
+})
 
 
 extern inline char *strCharCat(char *dest, char src);
@@ -225,7 +238,11 @@ extern inline char *strCharCat(char *dest, char src);
 
 
 /* *************************************************************************************************************************/
-#define strCaseCharCat_(dest, src) ({ for (char *s = !dest ? NULL : *dest ? dest + 1 : dest; s && (*s || (!(*s = lc(src)) && src)); ++s); dest; })
+#define strCaseCharCat_(dest, src) ({                                        \
+    char *d_ = (dest), c_ = (src), *e_ = d_;                                    \
+    if (d_ && c_) { while (*e_) ++e_; e_[0] = lc(c_), e_[1] = '\0'; }           \
+    d_;                                                                         \
+})
 
 extern inline char *strCaseCharCat(char *dest, char src);
 /* *************************************************************************************************************************/
@@ -234,8 +251,9 @@ extern inline char *strCaseCharCat(char *dest, char src);
 /* *************************************************************************************************************************/
 #define strChr_(str, ch) ({                             \
     register size_t i;                                  \
-    for (i = 0; str[i]!=ch && (str[i] || !ch); ++i);    \
-    str[i]==ch ? &str[i] : NULL;                        \
+    const char c_ = (char)(ch);                         \
+    for (i = 0; str[i]!=c_ && str[i]; ++i);             \
+    str[i]==c_ ? &str[i] : NULL;                        \
 })
 
 extern inline char *strChr(const char *str, unsigned char ch);
@@ -243,10 +261,11 @@ extern inline char *strChr(const char *str, unsigned char ch);
 
 
 /* *************************************************************************************************************************/
-#define strCaseChr_(str, ch) ({                                                \
-    register size_t i = 0;                                                     \
-    for (unsigned char ch = lc(c); lc(str[i])!=ch && (str[i] || !ch); ++i);    \
-    lc(str[i])==lc(c) ? &str[i] : NULL;                                        \
+#define strCaseChr_(str, ch) ({                                                 \
+    register size_t i;                                                          \
+    const char c_ = (char)lc((unsigned char)(ch));                              \
+    for (i = 0; lc(str[i])!=c_ && str[i]; ++i);                                 \
+    lc(str[i])==c_ ? &str[i] : NULL;                                            \
 })
 
 extern inline char *strCaseChr(const char *str, unsigned char ch);
@@ -254,12 +273,13 @@ extern inline char *strCaseChr(const char *str, unsigned char ch);
 
 
 /* *************************************************************************************************************************/
-#define strReverse_(str)                                                       \
-do {                                                                           \
-    register size_t n;                                                         \
-    strLen_(str, n);                                                           \
-    for (register size_t i = n>1 ? 0 : n; i < n/2; ++i)                        \
-        str[i] ^= str[n-1-i] ^= str[i] ^= str[n-1-i];                          \
+#define strReverse_(str)                                                        \
+do {                                                                            \
+    register size_t n = strLen_(str);                                           \
+    for (register size_t i = 0; i < n/2; ++i) {                                 \
+        char t_ = str[i];                                                       \
+        str[i] = str[n-1-i], str[n-1-i] = t_;                                   \
+    }                                                                           \
 } while (0)
 
 extern inline char *strReverse(char *str);
@@ -269,7 +289,7 @@ extern inline char *strReverse(char *str);
 /* *************************************************************************************************************************/
 #define strnReverse_(dest, src, n)                                                  \
 do {                                                                                \
-    for (char *s1 = dest, *s2 = src + n - 1; *s2 && s1 < dest + n; *s1++ = *s2--);  \
+    for (char *s1 = dest, *s2 = src + n; s1 < dest + n && s2[-1]; *s1++ = *--s2);   \
 } while (0)
 
 extern inline char *strnReverse(char *restrict dest, char *restrict source, size_t n);
@@ -299,29 +319,14 @@ extern inline char *strCaseMove(char *dest, char *source, size_t n);
 
 
 /* *************************************************************************************************************************/
-#define strStr_(str, sub) ({                            \
-    register unsigned short state = 0;                  \
-    register size_t pos = 0, matched = 0;               \
-    while (str[pos] && sub[matched]) {                  \
-        switch (state) {                                \
-            case 0:                                     \
-                if (str[pos]==sub[matched])             \
-                    ++matched, state = 1;               \
-                else state = 2;                         \
-            break;                                      \
-            case 1:                                     \
-                if (str[pos]==sub[matched])             \
-                    ++matched;                          \
-                else matched = 0, state = 2;            \
-            break;                                      \
-            case 2:                                     \
-                if (str[pos]==sub[matched])             \
-                    ++matched, state = 1;               \
-            break;                                      \
-        }                                               \
-        ++pos;                                          \
-    }                                                   \
-    str[pos] ? &str[pos-matched] : NULL;                \
+#define strStr_(str, sub) ({                                                                        \
+    char *h_ = (char *)(str), *n_ = (char *)(sub), *r_ = NULL;                                      \
+    for (register size_t i_ = 0, k_;; ++i_) {                                                       \
+        for (k_ = 0; n_[k_] && h_[i_+k_] == n_[k_]; ++k_);     /* Stops at the NUL of either */     \
+        if (!n_[k_]) { r_ = &h_[i_]; break; }                                                       \
+        if (!h_[i_]) break;                                                                         \
+    }                                                                                               \
+    r_;                                                                                             \
 })
 
 extern inline char *strStr(char *str, char *sub);
@@ -329,29 +334,14 @@ extern inline char *strStr(char *str, char *sub);
 
 
 /* *************************************************************************************************************************/
-#define strCaseStr_(str, sub) ({                        \
-    register unsigned short state = 0;                  \
-    register size_t pos = 0, matched = 0;               \
-    while (str[pos] && sub[matched]) {                  \
-        switch (state) {                                \
-            case 0:                                     \
-                if (lc(str[pos])==lc(sub[matched]))     \
-                    ++matched, state = 1;               \
-                else state = 2;                         \
-            break;                                      \
-            case 1:                                     \
-                if (lc(str[pos])==lc(sub[matched]))     \
-                    ++matched;                          \
-                else matched = 0, state = 2;            \
-            break;                                      \
-            case 2:                                     \
-                if (lc(str[pos])==lc(sub[matched]))     \
-                    ++matched, state = 1;               \
-            break;                                      \
-        }                                               \
-        ++pos;                                          \
-    }                                                   \
-    str[pos] ? &str[pos-matched] : NULL;                \
+#define strCaseStr_(str, sub) ({                                                                    \
+    char *h_ = (char *)(str), *n_ = (char *)(sub), *r_ = NULL;                                      \
+    for (register size_t i_ = 0, k_;; ++i_) {                                                       \
+        for (k_ = 0; n_[k_] && lc(h_[i_+k_]) == lc(n_[k_]); ++k_);                                  \
+        if (!n_[k_]) { r_ = &h_[i_]; break; }                                                       \
+        if (!h_[i_]) break;                                                                         \
+    }                                                                                               \
+    r_;                                                                                             \
 })
 
 extern inline char *strCaseStr(char *str, char *sub);
@@ -359,75 +349,88 @@ extern inline char *strCaseStr(char *str, char *sub);
 
 
 /* *************************************************************************************************************************/
-#define strAllStr_(str, sub) ({                                                                                                                 \
-    register size_t state = 0, idx = 0, matched = 0, needles_found = 0, substr_space = 5;                                                       \
-    char **sub_strings = NULL;                                                                                                                  \
-    while (str[idx]) {                                                                                                                          \
-        switch (state) {                                                                                                                        \
-            case 0:                                                                                                                             \
-                if (str[idx] == sub[matched] && ++matched) state = 1;                                                                           \
-                else state = 2;                                                                                                                 \
-            break;                                                                                                                              \
-            case 1:                                                                                                                             \
-                if (str[idx] != sub[matched] && sub[matched]) {                                                                                 \
-                    state = 2, matched = 0;                                                                                                     \
-                } else if (!sub[matched++] || !sub[matched]) {                                                                                  \
-                    char **tmp_substrs = realloc(sub_strings,(++needles_found==substr_space ? substr_space*=2 : substr_space)*sizeof(char*));   \
-                    if (tmp_substrs) {                                                                                                          \
-                        sub_strings = tmp_substrs;                                                                                              \
-                        sub_strings[needles_found-1] = &str[idx-matched+1], sub_strings[needles_found] = NULL;                                  \
-                    } else break;                                                                                                               \
-                    state = 2, matched = 0;                                                                                                     \
-                }                                                                                                                               \
-            break;                                                                                                                              \
-            case 2:                                                                                                                             \
-                if (str[idx] == sub[matched] && ++matched) state = 1;                                                                           \
-            break;                                                                                                                              \
-        }                                                                                                                                       \
-        ++idx;                                                                                                                                  \
-    }                                                                                                                                           \
-    substr_space != needles_found ? realloc(sub_strings, needles_found * sizeof(char *)) : sub_strings;                                         \
-})                                                                                                                                              \
+// Allocating functions come in pairs: the plain version uses malloc and reports failure through errno, and the ...With
+// version takes a caller supplied StrAllocator. The allocator carries the error state, so a failure is reported without
+// touching globals, and a per-thread allocator (an arena, say) makes bulk searches safe to run in parallel. Both return
+// NULL on failure, never a partial result
 
-extern inline char **strAllStr(char *str, char *sub);
+typedef struct {                            /* Struct describing a caller supplied allocator */
+    void *(*resize)(void *ctx, void *ptr, size_t size);     // Allocate (ptr = NULL) or resize. NULL uses realloc
+    void (*release)(void *ctx, void *ptr);                  // Free ptr. NULL uses free
+    void *ctx;                              // Passed to both hooks, e.g. a per-thread arena
+    int error;                              // Set to ENOMEM when an allocation fails. Never cleared by the library
+} StrAllocator;
+
+#define STRALLOCATOR_DEFAULT ((StrAllocator){ NULL, NULL, NULL, 0 })
+
+extern inline void strFreeWith(StrAllocator *alloc, void *ptr);
 /* *************************************************************************************************************************/
 
 
 /* *************************************************************************************************************************/
-#define strCaseAllStr_(str, sub) ({                                                                                                             \
-    register size_t state = 0, idx = 0, matched = 0, needles_found = 0, substr_space = 5;                                                       \
-    char **sub_strings = NULL;                                                                                                                  \
-    while (str[idx]) {                                                                                                                          \
-        switch (state) {                                                                                                                        \
-            case 0:                                                                                                                             \
-                state = (lc(str[idx]) == lc(sub[matched]) && ++matched) ? 1 : state;                                                            \
-            break;                                                                                                                              \
-            case 1:                                                                                                                             \
-                if (lc(str[idx]) != lc(sub[matched]) && sub[matched])                                                                           \
-                    state = 0, matched = 0;                                                                                                     \
-                else if (!sub[matched++] || !sub[matched]) {                                                                                    \
-                    char **tmp_ss = realloc(sub_strings,(++needles_found==substr_space ? substr_space*=2 : substr_space)*sizeof(char*));        \
-                    if (tmp_ss) sub_strings = tmp_ss, sub_strings[needles_found-1] = &str[idx-matched+1], sub_strings[needles_found] = NULL;    \
-                    else break;                                                                                                                 \
-                    state = 0, matched = 0;                                                                                                     \
-                }                                                                                                                               \
-            break;                                                                                                                              \
-        }                                                                                                                                       \
-        ++idx;                                                                                                                                  \
-    }                                                                                                                                           \
-    substr_space != needles_found ? realloc(sub_strings, needles_found * sizeof(char *)) : sub_strings;                                         \
+#define strAllStr_(str, sub) ({                                                                     \
+    char *h_ = (char *)(str), *n_ = (char *)(sub), **all_ = malloc(4 * sizeof(char *)), **tmp_;     \
+    register size_t found_ = 0, space_ = 4, i_ = 0, k_;                                             \
+    if (all_) all_[0] = NULL;                                                                       \
+    else errno = 12;                                                                                \
+    while (all_ && *n_ && h_[i_]) {                                                                 \
+        for (k_ = 0; n_[k_] && h_[i_+k_] == n_[k_]; ++k_);                                          \
+        if (n_[k_]) {                                                                               \
+            ++i_;                                                                                   \
+            continue;                                                                               \
+        }                                                                                           \
+        if (found_ + 1 == space_) {                                                                 \
+            if (!(tmp_ = realloc(all_, (space_ *= 2) * sizeof(char *)))) {                          \
+                errno = 12;                                                                         \
+                break;                                                                              \
+            }                                                                                       \
+            all_ = tmp_;                                                                            \
+        }                                                                                           \
+        all_[found_++] = &h_[i_], all_[found_] = NULL, i_ += k_;                                    \
+    }                                                                                               \
+    all_;                                                                                           \
+})
+
+extern inline char **strAllStr(char *str, char *sub);
+extern inline char **strAllStrWith(StrAllocator *alloc, char *str, char *sub);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+#define strCaseAllStr_(str, sub) ({                                                                 \
+    char *h_ = (char *)(str), *n_ = (char *)(sub), **all_ = malloc(4 * sizeof(char *)), **tmp_;     \
+    register size_t found_ = 0, space_ = 4, i_ = 0, k_;                                             \
+    if (all_) all_[0] = NULL;                                                                       \
+    else errno = 12;                                                                                \
+    while (all_ && *n_ && h_[i_]) {                                                                 \
+        for (k_ = 0; n_[k_] && lc(h_[i_+k_]) == lc(n_[k_]); ++k_);                                  \
+        if (n_[k_]) {                                                                               \
+            ++i_;                                                                                   \
+            continue;                                                                               \
+        }                                                                                           \
+        if (found_ + 1 == space_) {                                                                 \
+            if (!(tmp_ = realloc(all_, (space_ *= 2) * sizeof(char *)))) {                          \
+                errno = 12;                                                                         \
+                break;                                                                              \
+            }                                                                                       \
+            all_ = tmp_;                                                                            \
+        }                                                                                           \
+        all_[found_++] = &h_[i_], all_[found_] = NULL, i_ += k_;                                    \
+    }                                                                                               \
+    all_;                                                                                           \
 })
 
 extern inline char **strCaseAllStr(char *str, char *sub);
+extern inline char **strCaseAllStrWith(StrAllocator *alloc, char *str, char *sub);
 /* *************************************************************************************************************************/
 
 
 /* *************************************************************************************************************************/
 #define strIsPal_(str) ({                                                                           \
-    size_t n = strLen_(str);                                                                        \
-    char end[(n/2)+1];                                                                              \
-    for (char *mid = str + (n/2) - !(n%2), *s1 = end, *s2 = str + n - 1; s2 > mid; *s1++ = *s2--);  \
-    (n < 2 || !strnCmp_(end,str,n/2)) ? true : false;                                               \
+    const char *p_ = (str);                                                                         \
+    size_t i_ = 0, j_ = strLen_((char *)p_);                                                        \
+    for (; i_ + 1 < j_ && p_[i_] == p_[j_-1]; ++i_, --j_);                                          \
+    i_ + 1 >= j_ ? true : false;                                                                    \
 })
 
 
@@ -437,10 +440,10 @@ extern inline bool strIsPal(const char *str);
 
 /* *************************************************************************************************************************/
 #define strCaseIsPal_(str) ({                                                                       \
-    size_t n = strLen_(str);                                                                        \
-    char end[(n/2)+1];                                                                              \
-    for (char *mid = str + (n/2) - !(n%2), *s1 = end, *s2 = str + n - 1; s2 > mid; *s1++ = *s2--);  \
-    (n < 2 || !strnCaseCmp_(end,str,n/2)) ? true : false;                                           \
+    const char *p_ = (str);                                                                         \
+    size_t i_ = 0, j_ = strLen_((char *)p_);                                                        \
+    for (; i_ + 1 < j_ && lc(p_[i_]) == lc(p_[j_-1]); ++i_, --j_);                                  \
+    i_ + 1 >= j_ ? true : false;                                                                    \
 })
 
 extern inline bool strCaseIsPal(const char *str);
@@ -449,20 +452,62 @@ extern inline bool strCaseIsPal(const char *str);
 
 /* *************************************************************************************************************************/
 #define strInsert_(s1, s2, idx) ({                                                                      \
-    size_t n1, n2;                               /* n1 = length s1, n2 = length s2 */                   \
-    char *p1, *p2;                                                                                      \
-    for (p1 = (char*)s1; *p1 && *++p1; ++p1);    /* Loop to get length of s1 */                         \
-    for (p2 = (char*)s2; *p2 && *++p2; ++p2);    /* Loop to get length of s2 */                         \
-    n1 = p1-s1, n2 = p2-s2;                      /* 1st loop shifts s1 back, 2nd copies s2 into s1 */   \
-    for (p1 = &s1[n1 + n2 - 1], p2 = &s1[n1 - 1], *p1 = *p2; p2 > &s1[idx]; *--p1 = *--p2);             \
-    for (p1 = &s1[idx], p2 = s2, *p1 = *p2; p1 < &s1[idx] + n2 - 1; *++p1 = *++p2);                     \
-    &s1[idx];                                                                                           \
+    char *d_ = (s1), *i_ = (char *)(s2);                                                                \
+    size_t n1_ = strLen_(d_), n2_ = strLen_(i_), at_ = (idx), k_;                                       \
+    if (at_ > n1_) at_ = n1_;                                  /* Past the end appends */               \
+    for (k_ = n1_ + 1; k_-- > at_; ) d_[k_ + n2_] = d_[k_];    /* Shift the tail back, NUL included */  \
+    for (k_ = 0; k_ < n2_; ++k_) d_[at_ + k_] = i_[k_];        /* Copy s2 into the gap */               \
+    &d_[at_];                                                                                           \
 })
 
 extern inline char *strInsert(char *s1, const char *s2, size_t idx);
 /* *************************************************************************************************************************/
 
 
+/* *************************************************************************************************************************/
+// No macro versions. cap is the size of the buffer holding s1, NUL included. If the result wouldn't fit, NULL is returned
+// and s1 is left unchanged. Inserted strings must not overlap s1
+
+typedef struct {                            /* Struct describing one fragment for strInsertAll */
+    const char *str;                        // String to insert
+    size_t idx;                             // Index in the original s1 to insert it at
+} StrFragment;
+
+extern inline char *strnInsert(char *s1, size_t cap, const char *s2, size_t idx);
+extern inline char *strSplice(char *s1, size_t cap, size_t idx, size_t del, const char *s2);
+extern inline char *strInsertAll(char *s1, size_t cap, const StrFragment *frags, size_t n);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions. Matches are found left to right without overlapping, like strAllStr. The number of replacements is
+// stored in *count unless count is NULL. Functions returning a new string return NULL if memory runs out
+
+typedef struct {                            /* Struct describing one entry of a strReplaceTable table */
+    const char *needle;                     // String to find (entries with an empty needle are ignored)
+    const char *rep;                        // String to replace it with
+} StrReplacement;
+
+extern inline char *strReplaceAll(const char *str, const char *needle, const char *rep, size_t *count);
+extern inline char *strCaseReplaceAll(const char *str, const char *needle, const char *rep, size_t *count);
+extern inline char *strReplaceAllInPlace(char *str, const char *needle, const char *rep, size_t *count);
+extern inline char *strReplaceTable(const char *str, const StrReplacement *table, size_t n, size_t *count);
+extern inline char *strReplaceAllWith(StrAllocator *alloc, const char *str, const char *needle, const char *rep, size_t *count);
+extern inline char *strCaseReplaceAllWith(StrAllocator *alloc, const char *str, const char *needle, const char *rep,
+                                          size_t *count);
+extern inline char *strReplaceTableWith(StrAllocator *alloc, const char *str, const StrReplacement *table, size_t n,
+                                        size_t *count);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern inline size_t strHistogram(const char *str, size_t *counts);
+extern inline size_t strCaseHistogram(const char *str, size_t *counts);
+/* *************************************************************************************************************************/
+
+
 /* *************************************************************************************************************************/
 // No macro versions
 
@@ -474,6 +519,11 @@ extern inline bool strCaseIsPerm(const char *s1, const char *s2);
 /* *************************************************************************************************************************/
 // No macro versions
 
+#define STRSORT_INSERTION_MAX 16            // Crossovers measured by bench/strsort.c: counting overtakes insertion sort at
+                                            // ~12 characters on letters and ~48 on arbitrary bytes (it walks more buckets),
+#define STRSORT_SMALL_COUNT_MAX 1024        // and the 8-way histogram overtakes the single-table count at ~1280-2048 on
+                                            // letters and ~512 on arbitrary bytes
+
 extern inline bool strSort(char *str);
 extern inline char *strCountSort(char *str);
 /* *************************************************************************************************************************/
@@ -484,15 +534,32 @@ extern inline char *strCountSort(char *str);
 
 extern inline bool strHasDups(char *str);
 extern inline bool strCaseHasDups(char *str);
+extern inline bool strnHasDups(const char *str, size_t n);
+extern inline bool strnCaseHasDups(const char *str, size_t n);
+extern inline size_t strHasDupsAll(char **strs, size_t n, bool *results);
+extern inline size_t strCaseHasDupsAll(char **strs, size_t n, bool *results);
 /* *************************************************************************************************************************/
 
 
 /* *************************************************************************************************************************/
 // No macro version
 
+#define PERMUTATION_BUFFER_SIZE (1 << 16)
+#define PERMUTATION_CHUNK_SIZE (1 << 20)
+
 extern inline size_t strPermutateAll(char *str, FILE *stream);
-static inline size_t _permutate_no_duplicates(char *str, size_t n, FILE *stream, size_t *perm_count);
-static inline size_t _permutate_has_duplicates(char *str, char *start, size_t n, FILE *stream, size_t *perm_count);
+extern inline size_t strPermutateAllParallel(char *str, FILE *stream, unsigned int threads, bool ordered);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern inline size_t strPermCount(const char *str, bool *overflow);
+extern inline double strPermCountLog10(const char *str);
+extern inline size_t strPermRank(const char *str, bool *overflow);
+extern inline bool strPermUnrank(char *str, size_t rank);
+extern inline char *strPermShuffle(char *str);
 /* *************************************************************************************************************************/
 
 
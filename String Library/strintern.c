@@ -0,0 +1,298 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strintern.c                                                                                                             *
+ * ======================================================================================================================= */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "strintern.h"
+#include "strhash.h"
+
+#define _ENTRY_CHUNK_BITS 10                                    // Entries are allocated 1024 at a time and never move
+#define _ENTRY_CHUNK (1 << _ENTRY_CHUNK_BITS)
+#define _ARENA_BLOCK (1 << 16)                                  // Default arena block size, larger strings get their own
+#define _MIN_SLOTS 64
+#define _MAX_PER_SHARD ((UINT32_MAX >> STRINTERN_SHARD_BITS) - 1) // Keeps every handle within 32 bits
+
+/* =========================================================================================================================
+ * _InternEntry - Where an interned string lives and how long it is. Entry i of a shard is chunks[i >> 10][i & 1023]
+ * ========================================================================================================================*/
+
+typedef struct {
+    const char *str;
+    size_t len;
+} _InternEntry;
+
+/* =========================================================================================================================
+ * _InternDir - Directory of entry chunks. When it fills up, a larger copy replaces it and the old one is kept (linked by
+ * prev) until the pool is destroyed, so a reader that loaded the old directory without a lock can still use it
+ * ========================================================================================================================*/
+
+typedef struct _InternDir {
+    struct _InternDir *prev;
+    size_t cap;
+    _InternEntry *chunks[];
+} _InternDir;
+
+typedef struct _ArenaBlock {
+    struct _ArenaBlock *next;
+    char data[];
+} _ArenaBlock;
+
+/* =========================================================================================================================
+ * _InternShard - One independently locked part of the pool. The hash table is open addressed with linear probing; each
+ * slot holds the top 32 bits of the string's hash (used both to pick the home slot and to skip most mismatches without
+ * touching the string) and the entry index + 1 (0 = empty)
+ * ========================================================================================================================*/
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t *slots;
+    size_t mask, count;
+    _Atomic(_InternDir *) dir;
+    _ArenaBlock *blocks;                                        // Arena: the newest block is at the head
+    size_t used, avail;                                         // Bytes used / left in the newest block
+} _InternShard;
+
+struct StrInternPool {
+    uint64_t seed;                                              // Random per pool so crafted keys can't flood one shard
+    _InternShard shards[STRINTERN_SHARDS];
+};
+
+/* =========================================================================================================================
+ * _arena_copy - Copies str[0, n) plus a terminating NUL into the shard's arena. Returns NULL if memory runs out
+ * ========================================================================================================================*/
+
+static char *_arena_copy(_InternShard *shard, const char *str, size_t n) {
+    if (n + 1 > shard->avail) {
+        size_t size = n + 1 > _ARENA_BLOCK / 4 ? n + 1 : _ARENA_BLOCK;
+        _ArenaBlock *block = malloc(sizeof(_ArenaBlock) + size);
+        if (!block) return NULL;
+        if (size == _ARENA_BLOCK || !shard->blocks) {
+            block->next = shard->blocks, shard->blocks = block;
+            shard->used = 0, shard->avail = size;
+        } else {                                                // Oversized string: keep filling the current block
+            block->next = shard->blocks->next, shard->blocks->next = block;
+            memcpy(block->data, str, n);
+            block->data[n] = '\0';
+            return block->data;
+        }
+    }
+    char *dst = shard->blocks->data + shard->used;
+    memcpy(dst, str, n);
+    dst[n] = '\0';
+    shard->used += n + 1, shard->avail -= n + 1;
+    return dst;
+}
+
+/* =========================================================================================================================
+ * _add_entry - Appends an entry to the shard, growing the directory and allocating chunks as needed. Returns false if
+ * memory runs out
+ * ========================================================================================================================*/
+
+static bool _add_entry(_InternShard *shard, const char *str, size_t len) {
+    _InternDir *dir = atomic_load_explicit(&shard->dir, memory_order_relaxed);
+    size_t index = shard->count, chunk = index >> _ENTRY_CHUNK_BITS;
+
+    if (!dir || chunk >= dir->cap) {
+        size_t cap = dir ? dir->cap * 2 : 4;
+        _InternDir *grown = calloc(1, sizeof(_InternDir) + cap * sizeof(_InternEntry *));
+        if (!grown) return false;
+        if (dir) memcpy(grown->chunks, dir->chunks, dir->cap * sizeof(_InternEntry *));
+        grown->prev = dir, grown->cap = cap;
+        atomic_store_explicit(&shard->dir, grown, memory_order_release);
+        dir = grown;
+    }
+    if (!dir->chunks[chunk] && !(dir->chunks[chunk] = malloc(_ENTRY_CHUNK * sizeof(_InternEntry)))) return false;
+
+    dir->chunks[chunk][index & (_ENTRY_CHUNK - 1)] = (_InternEntry){ str, len };
+    return true;
+}
+
+static inline _InternEntry *_entry(_InternDir *dir, size_t index) {
+    return &dir->chunks[index >> _ENTRY_CHUNK_BITS][index & (_ENTRY_CHUNK - 1)];
+}
+
+/* =========================================================================================================================
+ * _grow_table - Doubles the shard's hash table. Slots carry their hash bits, so nothing is rehashed from the strings
+ * ========================================================================================================================*/
+
+static bool _grow_table(_InternShard *shard) {
+    size_t mask = shard->slots ? shard->mask * 2 + 1 : _MIN_SLOTS - 1;
+    uint64_t *slots = calloc(mask + 1, sizeof(uint64_t));
+    if (!slots) return false;
+    if (shard->slots) {
+        for (size_t i = 0; i <= shard->mask; ++i) {
+            if (!shard->slots[i]) continue;
+            size_t j = (shard->slots[i] >> 32) & mask;
+            while (slots[j]) j = (j + 1) & mask;
+            slots[j] = shard->slots[i];
+        }
+        free(shard->slots);
+    }
+    shard->slots = slots, shard->mask = mask;
+    return true;
+}
+
+/* =========================================================================================================================
+ * _intern - Finds str[0, n) in the pool, inserting it if 'insert' is set. Returns its handle, or STRINTERN_NONE if it's
+ * absent (and not inserted) or memory runs out
+ * ========================================================================================================================*/
+
+static StrHandle _intern(StrInternPool *pool, const char *str, size_t n, bool insert) {
+    uint64_t hash = strHashN(str, n, pool->seed);
+    unsigned int s = hash & (STRINTERN_SHARDS - 1);
+    uint32_t tag = (uint32_t)(hash >> 32);
+    _InternShard *shard = &pool->shards[s];
+    StrHandle handle = STRINTERN_NONE;
+
+    pthread_mutex_lock(&shard->lock);
+    if (shard->slots) {
+        _InternDir *dir = atomic_load_explicit(&shard->dir, memory_order_relaxed);
+        for (size_t i = tag & shard->mask; shard->slots[i]; i = (i + 1) & shard->mask) {
+            if ((uint32_t)(shard->slots[i] >> 32) != tag) continue;
+            uint32_t index = (uint32_t)shard->slots[i] - 1;
+            _InternEntry *e = _entry(dir, index);
+            if (e->len == n && !memcmp(e->str, str, n)) {
+                handle = (StrHandle)(((index << STRINTERN_SHARD_BITS) | s) + 1);
+                goto unlock;
+            }
+        }
+    }
+    if (!insert || shard->count >= _MAX_PER_SHARD) goto unlock;
+
+    // Keep the table at most half full, then store the string and claim the first empty slot on its probe path
+    if ((!shard->slots || (shard->count + 1) * 2 > shard->mask + 1) && !_grow_table(shard)) goto unlock;
+    char *copy = _arena_copy(shard, str, n);
+    if (!copy || !_add_entry(shard, copy, n)) goto unlock;
+
+    size_t i = tag & shard->mask;
+    while (shard->slots[i]) i = (i + 1) & shard->mask;
+    uint32_t index = (uint32_t)shard->count++;
+    shard->slots[i] = (uint64_t)tag << 32 | (index + 1);
+    handle = (StrHandle)(((index << STRINTERN_SHARD_BITS) | s) + 1);
+
+unlock:
+    pthread_mutex_unlock(&shard->lock);
+    return handle;
+}
+
+/* *************************************************************************************************************************
+ * strInternCreate - Creates an empty pool. Returns NULL if memory runs out
+ * *************************************************************************************************************************/
+
+StrInternPool *strInternCreate(void) {
+    StrInternPool *pool = calloc(1, sizeof(StrInternPool));
+    if (!pool) return NULL;
+    pool->seed = strHashSeed();
+    for (int i = 0; i < STRINTERN_SHARDS; ++i) {
+        pthread_mutex_init(&pool->shards[i].lock, NULL);
+        atomic_init(&pool->shards[i].dir, NULL);
+    }
+    return pool;
+}
+
+/* *************************************************************************************************************************
+ * strInternDestroy - Frees the pool and every string in it. Handles and strings from the pool become invalid
+ * *************************************************************************************************************************/
+
+void strInternDestroy(StrInternPool *pool) {
+    if (!pool) return;
+    for (int i = 0; i < STRINTERN_SHARDS; ++i) {
+        _InternShard *shard = &pool->shards[i];
+        _InternDir *dir = atomic_load_explicit(&shard->dir, memory_order_relaxed);
+        if (dir) for (size_t c = 0; c < dir->cap; ++c) free(dir->chunks[c]);
+        while (dir) {
+            _InternDir *prev = dir->prev;
+            free(dir);
+            dir = prev;
+        }
+        for (_ArenaBlock *block = shard->blocks, *next; block; block = next) {
+            next = block->next;
+            free(block);
+        }
+        free(shard->slots);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(pool);
+}
+
+/* *************************************************************************************************************************
+ * strIntern - Returns the handle for str, storing a copy of it in the pool the first time it's seen. Equal strings get
+ * equal handles. Safe to call from several threads at once. Returns STRINTERN_NONE if memory runs out
+ * *************************************************************************************************************************/
+
+StrHandle strIntern(StrInternPool *pool, const char *str) {
+    return _intern(pool, str, strlen(str), true);
+}
+
+/* *************************************************************************************************************************
+ * strInternN - strIntern for the n characters at str, which need not be NUL terminated (and may contain NULs)
+ * *************************************************************************************************************************/
+
+StrHandle strInternN(StrInternPool *pool, const char *str, size_t n) {
+    return _intern(pool, str, n, true);
+}
+
+/* *************************************************************************************************************************
+ * strCaseIntern - Interns the lowercase form of str, so strings equal under strCaseCmp get equal handles. The handle is
+ * the same one strIntern returns for the lowercase string
+ * *************************************************************************************************************************/
+
+StrHandle strCaseIntern(StrInternPool *pool, const char *str) {
+    size_t n = strlen(str);
+    char local[256], *lower = n < sizeof(local) ? local : malloc(n + 1);
+    if (!lower) return STRINTERN_NONE;
+    memcpy(lower, str, n + 1);
+    strnLwr(lower, n);
+    StrHandle handle = _intern(pool, lower, n, true);
+    if (lower != local) free(lower);
+    return handle;
+}
+
+/* *************************************************************************************************************************
+ * strInternFind - Returns the handle for str if it has been interned, STRINTERN_NONE otherwise. Never inserts
+ * *************************************************************************************************************************/
+
+StrHandle strInternFind(StrInternPool *pool, const char *str) {
+    return _intern(pool, str, strlen(str), false);
+}
+
+/* *************************************************************************************************************************
+ * strInternStr - Returns the interned string for a handle. The string stays valid, at the same address, until the pool
+ * is destroyed. Takes no lock, so it can run alongside inserts. Returns NULL for STRINTERN_NONE
+ * *************************************************************************************************************************/
+
+const char *strInternStr(const StrInternPool *pool, StrHandle handle) {
+    if (handle == STRINTERN_NONE) return NULL;
+    const _InternShard *shard = &pool->shards[(handle - 1) & (STRINTERN_SHARDS - 1)];
+    return _entry(atomic_load_explicit(&shard->dir, memory_order_acquire), (handle - 1) >> STRINTERN_SHARD_BITS)->str;
+}
+
+/* *************************************************************************************************************************
+ * strInternLen - Returns the length of the interned string for a handle without scanning it. 0 for STRINTERN_NONE
+ * *************************************************************************************************************************/
+
+size_t strInternLen(const StrInternPool *pool, StrHandle handle) {
+    if (handle == STRINTERN_NONE) return 0;
+    const _InternShard *shard = &pool->shards[(handle - 1) & (STRINTERN_SHARDS - 1)];
+    return _entry(atomic_load_explicit(&shard->dir, memory_order_acquire), (handle - 1) >> STRINTERN_SHARD_BITS)->len;
+}
+
+/* *************************************************************************************************************************
+ * strInternCount - Returns the number of distinct strings in the pool
+ * *************************************************************************************************************************/
+
+size_t strInternCount(StrInternPool *pool) {
+    size_t count = 0;
+    for (int i = 0; i < STRINTERN_SHARDS; ++i) {
+        pthread_mutex_lock(&pool->shards[i].lock);
+        count += pool->shards[i].count;
+        pthread_mutex_unlock(&pool->shards[i].lock);
+    }
+    return count;
+}
+
+/* *************************************************************************************************************************/
@@ -0,0 +1,53 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strintern.h                                                                                                             *
+ *                                                                                                                         *
+ * String interning pool. Each distinct string is stored once in an arena and identified by a 32-bit StrHandle, so         *
+ * equality between interned strings is a single integer compare instead of strCmp. strCaseIntern interns the lowercase    *
+ * form, which turns strCaseCmp equality into a handle compare as well. Inserts are thread safe: the pool is split into    *
+ * STRINTERN_SHARDS independently locked shards chosen by hash, so multi-threaded loaders rarely contend, and looking up   *
+ * the string for a handle takes no lock at all.                                                                           *
+ * ======================================================================================================================= */
+
+#ifndef strintern_h
+#define strintern_h
+
+#include <stdint.h>
+#include "strings.h"
+
+#define STRINTERN_SHARD_BITS 4
+#define STRINTERN_SHARDS (1 << STRINTERN_SHARD_BITS)
+#define STRINTERN_NONE 0                // Never a valid handle: returned when a string is absent or can't be stored
+
+/* *************************************************** TYPEDEFS ************************************************************/
+typedef uint32_t StrHandle;             /* Handle for an interned string, unique per distinct string within a pool */
+
+typedef struct StrInternPool StrInternPool;
+
+/* *************************************************************************************************************************/
+#define strInternEq_(h1, h2) ((h1) == (h2))
+
+extern StrInternPool *strInternCreate(void);
+extern void strInternDestroy(StrInternPool *pool);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern StrHandle strIntern(StrInternPool *pool, const char *str);
+extern StrHandle strInternN(StrInternPool *pool, const char *str, size_t n);
+extern StrHandle strCaseIntern(StrInternPool *pool, const char *str);
+extern StrHandle strInternFind(StrInternPool *pool, const char *str);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern const char *strInternStr(const StrInternPool *pool, StrHandle handle);
+extern size_t strInternLen(const StrInternPool *pool, StrHandle handle);
+extern size_t strInternCount(StrInternPool *pool);
+/* *************************************************************************************************************************/
+
+#endif /* strintern_h */
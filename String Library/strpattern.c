@@ -0,0 +1,188 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strpattern.c                                                                                                            *
+ * ======================================================================================================================= */
+
+#include <string.h>
+#include "strpattern.h"
+
+/* =========================================================================================================================
+ * _set_add / _set_has - 256-bit character set helpers used while parsing
+ * ========================================================================================================================*/
+
+static inline void _set_add(uint64_t *set, unsigned char c) {
+    set[c >> 6] |= (uint64_t)1 << (c & 63);
+}
+
+static inline bool _set_has(const uint64_t *set, unsigned char c) {
+    return set[c >> 6] >> (c & 63) & 1;
+}
+
+/* =========================================================================================================================
+ * _parse_class - Parses the set starting after '[' into set. Returns a pointer past the closing ']', or NULL if there is
+ * none. A ']' right after '[' (or '[!' / '[^') is literal, as is a '-' at either end of the set
+ * ========================================================================================================================*/
+
+static const char *_parse_class(const char *p, uint64_t *set, bool *negate) {
+    *negate = (*p == '!' || *p == '^');
+    if (*negate) ++p;
+    for (const char *first = p; *p != ']' || p == first; ) {
+        if (!*p) return NULL;
+        unsigned char lo = (unsigned char)*p++, hi = lo;
+        if (lo == '\\' && *p) lo = hi = (unsigned char)*p++;
+        if (*p == '-' && p[1] && p[1] != ']') {
+            hi = (unsigned char)p[1], p += 2;
+            if (hi == '\\' && *p) hi = (unsigned char)*p++;
+        }
+        for (unsigned int c = lo; c <= hi; ++c) _set_add(set, (unsigned char)c);
+    }
+    return p + 1;
+}
+
+/* =========================================================================================================================
+ * _compile - Parses pattern into pat. Each character position becomes one bit: its character set is scattered into
+ * sets[], so matching needs one lookup per character of the string no matter how large the sets are
+ * ========================================================================================================================*/
+
+static bool _compile(StrPattern *pat, const char *pattern, bool fold) {
+    memset(pat, 0, sizeof(StrPattern));
+    const char *p = pattern;
+    unsigned int count = 0;
+    bool star = false, leading_star = false;
+
+    if (*p == '^') pat->anchor_start = true, ++p;
+    for (;;) {
+        if (*p == '$' && !p[1]) {
+            pat->anchor_end = true;
+            break;
+        }
+        if (!*p) break;
+        if (*p == '*') {                                        // Runs of stars are one star
+            star = true, ++p;
+            if (!count) leading_star = true;
+            else pat->loops |= (uint64_t)1 << (count - 1);
+            continue;
+        }
+        if (count == STRPATTERN_MAX) {
+            pat->error = "pattern has more than STRPATTERN_MAX character positions";
+            return false;
+        }
+
+        uint64_t set[EXTENDED_ASCII_RANGE / 64] = {0};
+        bool negate = false;
+        if (*p == '?') {
+            memset(set, 0xFF, sizeof(set)), ++p;
+        } else if (*p == '[') {
+            if (!(p = _parse_class(p + 1, set, &negate))) {
+                pat->error = "unterminated character set";
+                return false;
+            }
+        } else {
+            if (*p == '\\' && p[1]) ++p;
+            _set_add(set, (unsigned char)*p++);
+        }
+
+        // Fold before negating, so [!a] also excludes 'A'
+        if (fold) {
+            for (unsigned char c = 'a'; c <= 'z'; ++c) {
+                if (_set_has(set, c) || _set_has(set, (unsigned char)(c - 0x20)))
+                    _set_add(set, c), _set_add(set, (unsigned char)(c - 0x20));
+            }
+        }
+        for (unsigned int c = 0; c < EXTENDED_ASCII_RANGE; ++c) {
+            if (_set_has(set, (unsigned char)c) != negate) pat->sets[c] |= (uint64_t)1 << count;
+        }
+        star = false, ++count;
+    }
+
+    // A star before the first position or after the last one lifts that end's anchor
+    if (leading_star) pat->anchor_start = false;
+    if (star) pat->anchor_end = false;
+    pat->last = count ? (uint64_t)1 << (count - 1) : 0;
+    return true;
+}
+
+/* *************************************************************************************************************************
+ * strPatCompile - Compiles pattern into pat. Returns false, with the reason in pat->error, if the pattern is invalid
+ * *************************************************************************************************************************/
+
+bool strPatCompile(StrPattern *pat, const char *pattern) {
+    return _compile(pat, pattern, false);
+}
+
+/* *************************************************************************************************************************
+ * strCasePatCompile - Compiles pattern into pat - Case insensitive
+ * *************************************************************************************************************************/
+
+bool strCasePatCompile(StrPattern *pat, const char *pattern) {
+    return _compile(pat, pattern, true);
+}
+
+/* *************************************************************************************************************************
+ * strPatMatchN - Determines whether the pattern matches the first n characters of str. Bit i of the state is set when
+ * positions 0-i match the characters just read: each character shifts the state one position forward (starting a new
+ * match at bit 0 unless anchored to the start), keeps only positions accepting it, and keeps positions followed by a
+ * star as they were
+ * *************************************************************************************************************************/
+
+bool strPatMatchN(const StrPattern *pat, const char *str, size_t n) {
+    if (!pat->last) return !(pat->anchor_start && pat->anchor_end) || !n;
+
+    const unsigned char *s = (const unsigned char *)str;
+    uint64_t state = 0, start = 1, loops = pat->loops, last = pat->last;
+    if (pat->anchor_end) {
+        for (size_t i = 0; i < n; ++i) {
+            state = (((state << 1) | start) & pat->sets[s[i]]) | (state & loops);
+            if (pat->anchor_start) start = 0;
+        }
+        return state & last;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        state = (((state << 1) | start) & pat->sets[s[i]]) | (state & loops);
+        if (state & last) return true;                         // Unanchored end: the first complete match decides
+        if (pat->anchor_start) {
+            if (!state) return false;                          // Every partial match has died and none can start
+            start = 0;
+        }
+    }
+    return false;
+}
+
+/* *************************************************************************************************************************
+ * strPatMatch - Determines whether the pattern matches str
+ * *************************************************************************************************************************/
+
+bool strPatMatch(const StrPattern *pat, const char *str) {
+    return strPatMatchN(pat, str, strlen(str));
+}
+
+/* *************************************************************************************************************************
+ * strPatMatchAll - Matches every string in strs (NULL entries don't match). Stores each result in results unless it is
+ * NULL and returns the number of matches
+ * *************************************************************************************************************************/
+
+size_t strPatMatchAll(const StrPattern *pat, char **strs, size_t n, bool *results) {
+    size_t matched = 0;
+    for (size_t i = 0; i < n; ++i) {
+        bool r = strs[i] && strPatMatch(pat, strs[i]);
+        if (results) results[i] = r;
+        matched += r;
+    }
+    return matched;
+}
+
+/* *************************************************************************************************************************
+ * strGlob / strCaseGlob - Compiles pattern and matches it against str
+ * *************************************************************************************************************************/
+
+bool strGlob(const char *pattern, const char *str) {
+    StrPattern pat;
+    return strPatCompile(&pat, pattern) && strPatMatch(&pat, str);
+}
+
+bool strCaseGlob(const char *pattern, const char *str) {
+    StrPattern pat;
+    return strCasePatCompile(&pat, pattern) && strPatMatch(&pat, str);
+}
+
+/* *************************************************************************************************************************/
@@ -0,0 +1,59 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strpattern.h                                                                                                            *
+ *                                                                                                                         *
+ * Compiled wildcard patterns. A pattern is searched for anywhere in a string unless anchored:                             *
+ *                                                                                                                         *
+ *     ?        any one character               [abc] [a-z]   one character from the set                                   *
+ *     *        any run of characters           [!a-z] [^a-z] one character not in the set                                 *
+ *     ^        (first) anchors to the start    $             (last) anchors to the end                                    *
+ *     \x       the character x literally                                                                                  *
+ *                                                                                                                         *
+ * Patterns compile to a bit-parallel (Shift-And) matcher: one machine word holds the state of every pattern position, so  *
+ * matching is a table lookup, a shift and two masks per character, linear in the string with no backtracking. Case        *
+ * insensitive patterns fold A-Z/a-z into the character sets at compile time, like the strCase functions, so they match    *
+ * at the same speed.                                                                                                      *
+ * ======================================================================================================================= */
+
+#ifndef strpattern_h
+#define strpattern_h
+
+#include <stdint.h>
+#include "strings.h"
+
+#define STRPATTERN_MAX 64               // Maximum number of character positions (everything but '*' and anchors)
+
+/* *************************************************** TYPEDEFS ************************************************************/
+typedef struct {                        /* Struct holding a compiled pattern */
+    uint64_t sets[EXTENDED_ASCII_RANGE];// Bit i of sets[c] is set if position i accepts character c
+    uint64_t loops;                     // Bit i is set if position i is followed by '*'
+    uint64_t last;                      // Bit of the final position (0 if the pattern has none)
+    bool anchor_start, anchor_end;
+    const char *error;                  // Why compiling failed, NULL on success
+} StrPattern;
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern bool strPatCompile(StrPattern *pat, const char *pattern);
+extern bool strCasePatCompile(StrPattern *pat, const char *pattern);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions
+
+extern bool strPatMatch(const StrPattern *pat, const char *str);
+extern bool strPatMatchN(const StrPattern *pat, const char *str, size_t n);
+extern size_t strPatMatchAll(const StrPattern *pat, char **strs, size_t n, bool *results);
+/* *************************************************************************************************************************/
+
+
+/* *************************************************************************************************************************/
+// No macro versions. One-off matches: compile and match in one call. Return false for an invalid pattern
+
+extern bool strGlob(const char *pattern, const char *str);
+extern bool strCaseGlob(const char *pattern, const char *str);
+/* *************************************************************************************************************************/
+
+#endif /* strpattern_h */
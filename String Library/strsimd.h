@@ -0,0 +1,36 @@
+/* ======================================================================================================================= *
+ * Dave Dorzback                                                                                                           *
+ * strsimd.h                                                                                                               *
+ *                                                                                                                         *
+ * Internal SSE2 helpers shared by strings.c, strbatch.c and the header only strfixed.h, so every case insensitive kernel  *
+ * folds 16 characters the same way. Not part of the public interface: everything here is static and '_' prefixed, and     *
+ * the file is empty when SSE2 isn't available.                                                                            *
+ * ======================================================================================================================= */
+
+#ifndef strsimd_h
+#define strsimd_h
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__)
+
+/* =========================================================================================================================
+ * _simd_lc / _simd_uc - Case fold 16 characters at once. Same ranges as the lc and uc macros: only A-Z / a-z are changed,
+ * bytes >= 0x80 compare as negative and are left alone. Forced inline so strfixed.h kernels still fold to constants
+ * ========================================================================================================================*/
+
+static inline __attribute__((always_inline)) __m128i _simd_lc(__m128i v) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x40)), _mm_cmplt_epi8(v, _mm_set1_epi8(0x5b)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static inline __attribute__((always_inline)) __m128i _simd_uc(__m128i v) {
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x60)), _mm_cmplt_epi8(v, _mm_set1_epi8(0x7b)));
+    return _mm_andnot_si128(_mm_and_si128(lower, _mm_set1_epi8(0x20)), v);
+}
+
+#endif
+
+#endif /* strsimd_h */